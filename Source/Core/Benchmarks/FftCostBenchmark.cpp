@@ -0,0 +1,71 @@
+// Times RealFft's batched path against RealFft::estimateCost(), at window
+// lengths the node uses after decimation. The step cost shown in the editor
+// comes from that model, so rerun this when the FFT or the compiler changes:
+//
+//     cmake -S Source/Core -B build-core && cmake --build build-core
+//     build-core/FftCostBenchmark
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#include "RealFft.h"
+
+using namespace SpectrogramViewer;
+
+namespace
+{
+	/** Transforms per call, as for 64 channels one frame at a time. */
+	const int NUM_TRANSFORMS = 64;
+
+	/** Samples transformed per length, so that every length takes about as long. */
+	const double SAMPLES_PER_LENGTH = 1e8;
+}
+
+int main()
+{
+	std::printf("%8s %14s %14s %8s\n", "length", "measured (ns)", "model (ns)", "ratio");
+
+	for (int length : { 16, 50, 64, 100, 150, 250, 256, 500, 1000, 1024, 1500, 2000, 3000, 4096, 1110, 2003 })
+	{
+		int numBins = length / 2 + 1;
+		std::vector<float> inputs(NUM_TRANSFORMS * length);
+		std::vector<float> outputs(NUM_TRANSFORMS * numBins);
+		std::vector<const float*> in(NUM_TRANSFORMS);
+		std::vector<float*> out(NUM_TRANSFORMS);
+
+		for (int i = 0; i < (int)inputs.size(); i++)
+		{
+			inputs[i] = float(i % 7) - 3;
+		}
+
+		for (int t = 0; t < NUM_TRANSFORMS; t++)
+		{
+			in[t] = &inputs[t * length];
+			out[t] = &outputs[t * numBins];
+		}
+
+		RealFft fft;
+		fft.prepare(length);
+
+		// One untimed call to touch the buffers.
+		fft.calcMagnitudes(in.data(), out.data(), NUM_TRANSFORMS, numBins, 1.f);
+
+		int numCalls = std::max(1, int(SAMPLES_PER_LENGTH / (double(length) * NUM_TRANSFORMS)));
+		auto start = std::chrono::steady_clock::now();
+
+		for (int c = 0; c < numCalls; c++)
+		{
+			fft.calcMagnitudes(in.data(), out.data(), NUM_TRANSFORMS, numBins, 1.f);
+		}
+
+		std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+		double measured = elapsed.count() / (double(numCalls) * NUM_TRANSFORMS);
+		double model = RealFft::estimateCost(length);
+
+		std::printf("%8d %14.0f %14.0f %8.2f\n", length, measured, model, measured / model);
+	}
+
+	return 0;
+}
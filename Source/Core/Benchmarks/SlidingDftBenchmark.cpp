@@ -0,0 +1,93 @@
+// Times SlidingDft against RealFft per frame, over the hops where one takes
+// over from the other, and checks both against their cost models. The
+// pipeline picks the engine from the models, so rerun this when either
+// engine or the compiler changes:
+//
+//     cmake -S Source/Core -B build-core && cmake --build build-core
+//     build-core/SlidingDftBenchmark
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#include "RealFft.h"
+#include "SlidingDft.h"
+
+using namespace SpectrogramViewer;
+
+namespace
+{
+	/** Channels per call, as for 64 channels one frame at a time. */
+	const int NUM_CHANNELS = 64;
+
+	/** Samples taken in per measurement, so that every case takes about as long. */
+	const double SAMPLES_PER_CASE = 2e6;
+
+	/** Returns the time of one frame of one channel, in nanoseconds, of calling
+	calcFrame() until it has taken in SAMPLES_PER_CASE samples in steps of hop. */
+	template <typename CalcFrame>
+	double timeFrames(int hop, CalcFrame calcFrame)
+	{
+		// One untimed call to touch the buffers.
+		calcFrame();
+
+		int numFrames = std::max(1, int(SAMPLES_PER_CASE / (double(hop) * NUM_CHANNELS)));
+		auto start = std::chrono::steady_clock::now();
+
+		for (int f = 0; f < numFrames; f++)
+		{
+			calcFrame();
+		}
+
+		std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+		return elapsed.count() / (double(numFrames) * NUM_CHANNELS);
+	}
+}
+
+int main()
+{
+	std::printf("%8s %6s %6s %12s %12s %12s %12s %8s\n",
+		"length", "bins", "hop", "sliding (ns)", "model (ns)", "fft (ns)", "model (ns)", "faster");
+
+	// After decimation the shown bins are about 2/5 of a window's length.
+	for (int length : { 250, 750, 1500, 3000 })
+	{
+		int numBins = 2 * length / 5 + 1;
+		std::vector<float> inputs(NUM_CHANNELS * length);
+		std::vector<float> outputs(NUM_CHANNELS * numBins);
+		std::vector<const float*> in(NUM_CHANNELS);
+		std::vector<float*> out(NUM_CHANNELS);
+
+		for (int i = 0; i < (int)inputs.size(); i++)
+		{
+			inputs[i] = float(i % 7) - 3;
+		}
+
+		for (int c = 0; c < NUM_CHANNELS; c++)
+		{
+			in[c] = &inputs[c * length];
+			out[c] = &outputs[c * numBins];
+		}
+
+		RealFft fft;
+		fft.prepare(length);
+		fft.setWindow(makeWindow(WINDOW_HANN, length));
+		double fftMeasured = timeFrames(length, [&] { fft.calcMagnitudes(in.data(), out.data(), NUM_CHANNELS, numBins, 1.f); });
+		double fftModel = RealFft::estimateCost(length);
+
+		for (int hop : { 1, 2, 4, 8, 16, 32 })
+		{
+			SlidingDft slidingDft;
+			slidingDft.prepare(NUM_CHANNELS, length, hop, numBins, WINDOW_HANN);
+			double measured = timeFrames(hop, [&] { slidingDft.calcMagnitudes(in.data(), out.data(), 1, 1.f); });
+			double model = SlidingDft::estimateCost(hop, numBins);
+
+			std::printf("%8d %6d %6d %12.0f %12.0f %12.0f %12.0f %8s\n",
+				length, numBins, hop, measured, model, fftMeasured, fftModel,
+				measured < fftMeasured ? "sliding" : "fft");
+		}
+	}
+
+	return 0;
+}
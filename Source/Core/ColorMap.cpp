@@ -0,0 +1,81 @@
+#include "ColorMap.h"
+#include "SimdKernels.h"
+
+using namespace SpectrogramViewer;
+
+ColorQuantizer::ColorQuantizer(float minLog10_, float maxLog10_, bool decibelInput_)
+	: minLog10(minLog10_), maxLog10(maxLog10_), decibelInput(decibelInput_)
+{
+	const float log10Of2 = 0.30102999566f;
+	float levelsPerLog10 = NUM_COLOR_LEVELS / (maxLog10 - minLog10);
+
+	levelsPerLog2 = levelsPerLog10 * log10Of2;
+	levelsPerDecibel = levelsPerLog10 / 20;
+	levelOffset = -minLog10 * levelsPerLog10;
+}
+
+void ColorQuantizer::quantize(const float* values, uint8_t* levels, int numValues) const
+{
+	auto& kernels = getSimdKernels();
+
+	if (decibelInput)
+	{
+		kernels.quantize(values, levels, numValues, levelsPerDecibel, levelOffset, NUM_COLOR_LEVELS - 1);
+	}
+	else
+	{
+		kernels.logQuantize(values, levels, numValues, levelsPerLog2, levelOffset, NUM_COLOR_LEVELS - 1);
+	}
+}
+
+void ColorQuantizer::toPixels(const float* values, uint32_t* pixels, int numValues) const
+{
+	const int blockSize = 256;
+	uint8_t levels[blockSize];
+
+	for (int from = 0; from < numValues; from += blockSize)
+	{
+		int count = numValues - from < blockSize ? numValues - from : blockSize;
+		quantize(values + from, levels, count);
+
+		for (int i = 0; i < count; i++)
+		{
+			pixels[from + i] = infernoPalette[levels[i]];
+		}
+	}
+}
+
+const uint32_t SpectrogramViewer::infernoPalette[NUM_COLOR_LEVELS] = {
+		0xff000004, 0xff010005, 0xff010106, 0xff010108, 0xff02010a, 0xff02020c, 0xff02020e, 0xff030210,
+		0xff040312, 0xff040314, 0xff050417, 0xff060419, 0xff07051b, 0xff08051d, 0xff09061f, 0xff0a0722,
+		0xff0b0724, 0xff0c0826, 0xff0d0829, 0xff0e092b, 0xff10092d, 0xff110a30, 0xff120a32, 0xff140b34,
+		0xff150b37, 0xff160b39, 0xff180c3c, 0xff190c3e, 0xff1b0c41, 0xff1c0c43, 0xff1e0c45, 0xff1f0c48,
+		0xff210c4a, 0xff230c4c, 0xff240c4f, 0xff260c51, 0xff280b53, 0xff290b55, 0xff2b0b57, 0xff2d0b59,
+		0xff2f0a5b, 0xff310a5c, 0xff320a5e, 0xff340a5f, 0xff360961, 0xff380962, 0xff390963, 0xff3b0964,
+		0xff3d0965, 0xff3e0966, 0xff400a67, 0xff420a68, 0xff440a68, 0xff450a69, 0xff470b6a, 0xff490b6a,
+		0xff4a0c6b, 0xff4c0c6b, 0xff4d0d6c, 0xff4f0d6c, 0xff510e6c, 0xff520e6d, 0xff540f6d, 0xff550f6d,
+		0xff57106e, 0xff59106e, 0xff5a116e, 0xff5c126e, 0xff5d126e, 0xff5f136e, 0xff61136e, 0xff62146e,
+		0xff64156e, 0xff65156e, 0xff67166e, 0xff69166e, 0xff6a176e, 0xff6c186e, 0xff6d186e, 0xff6f196e,
+		0xff71196e, 0xff721a6e, 0xff741a6e, 0xff751b6e, 0xff771c6d, 0xff781c6d, 0xff7a1d6d, 0xff7c1d6d,
+		0xff7d1e6d, 0xff7f1e6c, 0xff801f6c, 0xff82206c, 0xff84206b, 0xff85216b, 0xff87216b, 0xff88226a,
+		0xff8a226a, 0xff8c2369, 0xff8d2369, 0xff8f2469, 0xff902568, 0xff922568, 0xff932667, 0xff952667,
+		0xff972766, 0xff982766, 0xff9a2865, 0xff9b2964, 0xff9d2964, 0xff9f2a63, 0xffa02a63, 0xffa22b62,
+		0xffa32c61, 0xffa52c60, 0xffa62d60, 0xffa82e5f, 0xffa92e5e, 0xffab2f5e, 0xffad305d, 0xffae305c,
+		0xffb0315b, 0xffb1325a, 0xffb3325a, 0xffb43359, 0xffb63458, 0xffb73557, 0xffb93556, 0xffba3655,
+		0xffbc3754, 0xffbd3853, 0xffbf3952, 0xffc03a51, 0xffc13a50, 0xffc33b4f, 0xffc43c4e, 0xffc63d4d,
+		0xffc73e4c, 0xffc83f4b, 0xffca404a, 0xffcb4149, 0xffcc4248, 0xffce4347, 0xffcf4446, 0xffd04545,
+		0xffd24644, 0xffd34743, 0xffd44842, 0xffd54a41, 0xffd74b3f, 0xffd84c3e, 0xffd94d3d, 0xffda4e3c,
+		0xffdb503b, 0xffdd513a, 0xffde5238, 0xffdf5337, 0xffe05536, 0xffe15635, 0xffe25734, 0xffe35933,
+		0xffe45a31, 0xffe55c30, 0xffe65d2f, 0xffe75e2e, 0xffe8602d, 0xffe9612b, 0xffea632a, 0xffeb6429,
+		0xffeb6628, 0xffec6726, 0xffed6925, 0xffee6a24, 0xffef6c23, 0xffef6e21, 0xfff06f20, 0xfff1711f,
+		0xfff1731d, 0xfff2741c, 0xfff3761b, 0xfff37819, 0xfff47918, 0xfff57b17, 0xfff57d15, 0xfff67e14,
+		0xfff68013, 0xfff78212, 0xfff78410, 0xfff8850f, 0xfff8870e, 0xfff8890c, 0xfff98b0b, 0xfff98c0a,
+		0xfff98e09, 0xfffa9008, 0xfffa9207, 0xfffa9407, 0xfffb9606, 0xfffb9706, 0xfffb9906, 0xfffb9b06,
+		0xfffb9d07, 0xfffc9f07, 0xfffca108, 0xfffca309, 0xfffca50a, 0xfffca60c, 0xfffca80d, 0xfffcaa0f,
+		0xfffcac11, 0xfffcae12, 0xfffcb014, 0xfffcb216, 0xfffcb418, 0xfffbb61a, 0xfffbb81d, 0xfffbba1f,
+		0xfffbbc21, 0xfffbbe23, 0xfffac026, 0xfffac228, 0xfffac42a, 0xfffac62d, 0xfff9c72f, 0xfff9c932,
+		0xfff9cb35, 0xfff8cd37, 0xfff8cf3a, 0xfff7d13d, 0xfff7d340, 0xfff6d543, 0xfff6d746, 0xfff5d949,
+		0xfff5db4c, 0xfff4dd4f, 0xfff4df53, 0xfff4e156, 0xfff3e35a, 0xfff3e55d, 0xfff2e661, 0xfff2e865,
+		0xfff2ea69, 0xfff1ec6d, 0xfff1ed71, 0xfff1ef75, 0xfff1f179, 0xfff2f27d, 0xfff2f482, 0xfff3f586,
+		0xfff3f68a, 0xfff4f88e, 0xfff5f992, 0xfff6fa96, 0xfff8fb9a, 0xfff9fc9d, 0xfffafda1, 0xfffcffa4
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+
+namespace SpectrogramViewer
+{
+	/** Number of colour levels that magnitudes are quantized to. */
+	const int NUM_COLOR_LEVELS = 256;
+
+	/** Default range of the colour scale, as log10 of magnitudes in V/sqrt(Hz):
+	100 nV to 100 mV, which is what the canvas's scale ticks show. */
+	const float DEFAULT_MIN_LOG10 = -7;
+	const float DEFAULT_MAX_LOG10 = -1;
+
+	/** The inferno colour map as opaque packed 0xAARRGGBB values, darkest first. */
+	extern const uint32_t infernoPalette[NUM_COLOR_LEVELS];
+
+	/** Maps spectrogram magnitudes to colour levels on a log10 scale.
+
+	Magnitudes at or below 10^minLog10 map to level 0, magnitudes at or above
+	10^maxLog10 map to the last level, and NaN (no data) maps to level 0.
+	The levels are computed with SimdKernels::logQuantize.
+
+	With decibel input, the values are 20 log10 of the magnitudes instead and
+	map to the same levels, so no log is taken here: quantizing is a
+	multiply-add per value (SimdKernels::quantize).
+	*/
+	class ColorQuantizer
+	{
+	public:
+		ColorQuantizer(float minLog10 = DEFAULT_MIN_LOG10, float maxLog10 = DEFAULT_MAX_LOG10, bool decibelInput = false);
+
+		float getMinLog10() const { return minLog10; }
+		float getMaxLog10() const { return maxLog10; }
+
+		bool isDecibelInput() const { return decibelInput; }
+		void setDecibelInput(bool newDecibelInput) { decibelInput = newDecibelInput; }
+
+		/** Writes the colour level of each of numValues magnitudes (or dB values,
+		see isDecibelInput()) into levels. */
+		void quantize(const float* values, uint8_t* levels, int numValues) const;
+
+		/** Quantizes the values and resolves them straight through the palette. */
+		void toPixels(const float* values, uint32_t* pixels, int numValues) const;
+
+	private:
+		float minLog10;
+		float maxLog10;
+		bool decibelInput;
+
+		// level = log2(value) * levelsPerLog2 + levelOffset
+		//       = decibels * levelsPerDecibel + levelOffset
+		float levelsPerLog2;
+		float levelsPerDecibel;
+		float levelOffset;
+	};
+}
@@ -0,0 +1,140 @@
+#include <algorithm>
+#include <cmath>
+
+#include "pocketfft_hdronly.h"
+#include "ComplexFft.h"
+#include "SimdKernels.h"
+
+using namespace SpectrogramViewer;
+
+namespace
+{
+	using pocketfft::detail::arr;
+	using pocketfft::detail::cmplx;
+}
+
+struct ComplexFft::Plan
+{
+	Plan(int length) : fft(length) {}
+
+	pocketfft::detail::pocketfft_c<float> fft;
+};
+
+struct ComplexFft::Workspace
+{
+	Workspace(int length) : data(length), scratch(length) {}
+
+	arr<cmplx<float>> data;
+	arr<cmplx<float>> scratch;
+};
+
+ComplexFft::ComplexFft()
+{
+}
+
+ComplexFft::~ComplexFft()
+{
+}
+
+void ComplexFft::prepare(int newLength, int numThreads, int newInputLength)
+{
+	numThreads = std::max(1, numThreads);
+	newInputLength = (newInputLength > 0) ? std::min(newInputLength, newLength) : newLength;
+
+	if (newLength == length && newInputLength == inputLength && numThreads == getNumThreads() && plan)
+	{
+		return;
+	}
+
+	plan.reset(new Plan(newLength));
+	workspaces.clear();
+
+	for (int i = 0; i < numThreads; i++)
+	{
+		workspaces.emplace_back(new Workspace(newLength));
+	}
+
+	window.assign(newInputLength, 1.f);
+	length = newLength;
+	inputLength = newInputLength;
+}
+
+void ComplexFft::setWindow(const std::vector<float>& newWindow)
+{
+	std::copy(newWindow.begin(), newWindow.begin() + std::min<size_t>(inputLength, newWindow.size()), window.begin());
+}
+
+void ComplexFft::calcMagnitudes(
+	const float* const* re,
+	const float* const* im,
+	float* const* out,
+	int numTransforms,
+	int firstBin,
+	int numBins,
+	float scalingFactor)
+{
+	int numThreads = std::min(getNumThreads(), numTransforms);
+
+	if (numThreads <= 1)
+	{
+		calcRange(*workspaces[0], re, im, out, numTransforms, firstBin, numBins, scalingFactor);
+		return;
+	}
+
+	pocketfft::detail::threading::thread_map(numThreads, [&]
+	{
+		int threadIndex = pocketfft::detail::threading::thread_id();
+		int from = numTransforms * threadIndex / numThreads;
+		int to = numTransforms * (threadIndex + 1) / numThreads;
+
+		calcRange(
+			*workspaces[threadIndex],
+			re + from, im + from, out + from,
+			to - from, firstBin, numBins, scalingFactor);
+	});
+}
+
+void ComplexFft::calcRange(
+	Workspace& workspace,
+	const float* const* re,
+	const float* const* im,
+	float* const* out,
+	int numTransforms,
+	int firstBin,
+	int numBins,
+	float scalingFactor)
+{
+	bool forward = true;
+	auto data = workspace.data.data();
+	auto windowValues = window.data();
+	auto& kernels = getSimdKernels();
+
+	for (int transform = 0; transform < numTransforms; transform++)
+	{
+		auto real = re[transform];
+		auto imag = im[transform];
+
+		for (int i = 0; i < inputLength; i++)
+		{
+			data[i] = cmplx<float>(real[i] * windowValues[i], imag[i] * windowValues[i]);
+		}
+
+		std::fill(data + inputLength, data + length, cmplx<float>(0, 0));
+
+		// The scaling is fused into the magnitudes instead of a pass of its own.
+		plan->fft.exec(data, 1.f, forward, workspace.scratch.data());
+
+		// Negative bins are stored at the top of the transform, so the shown
+		// bins are at most a run up to the end plus a run from the start.
+		auto outColumn = out[transform];
+		int bin = (firstBin % length + length) % length;
+
+		for (int done = 0; done < numBins;)
+		{
+			int runLength = std::min(numBins - done, length - bin);
+			kernels.complexMagnitudes(&data[bin].r, outColumn + done, runLength, scalingFactor);
+			done += runLength;
+			bin = 0;
+		}
+	}
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+namespace SpectrogramViewer
+{
+	/** Magnitude spectra of complex signals, computed with a persistent pocketfft plan.
+
+	The complex counterpart of RealFft, used for band (zoom FFT) spectrograms:
+	the input is a band that has been shifted to 0 Hz, so the bins of interest
+	lie on both sides of DC.
+	*/
+	class ComplexFft
+	{
+	public:
+		ComplexFft();
+		~ComplexFft();
+
+		/** Builds the plan and the working buffers for transforms of the given
+		length. Transforms are split across numThreads threads as in RealFft.
+		Inputs are inputLength samples long and zero-padded to the transform
+		length; 0 means the transform length. */
+		void prepare(int length, int numThreads = 1, int inputLength = 0);
+
+		/** Returns the transform length set by prepare(), or 0 if not prepared. */
+		int getLength() const { return length; }
+
+		int getInputLength() const { return inputLength; }
+
+		int getNumThreads() const { return int(workspaces.size()); }
+
+		/** Sets the window that inputs are multiplied by as they are copied into
+		the transform buffer. prepare() resets it to a rectangular window when
+		the length changes. */
+		void setWindow(const std::vector<float>& newWindow);
+
+		/** Computes numBins magnitudes of the FFTs of the windowed re[t] + i im[t],
+		starting at bin firstBin. Negative bins are below DC. Every output is
+		multiplied by scalingFactor.
+		*/
+		void calcMagnitudes(
+			const float* const* re,
+			const float* const* im,
+			float* const* out,
+			int numTransforms,
+			int firstBin,
+			int numBins,
+			float scalingFactor);
+
+	private:
+		struct Plan;
+		struct Workspace;
+
+		std::unique_ptr<Plan> plan;
+		std::vector<std::unique_ptr<Workspace>> workspaces;
+		std::vector<float> window;
+		int length = 0;
+		int inputLength = 0;
+
+		void calcRange(
+			Workspace& workspace,
+			const float* const* re,
+			const float* const* im,
+			float* const* out,
+			int numTransforms,
+			int firstBin,
+			int numBins,
+			float scalingFactor);
+
+		ComplexFft(const ComplexFft&) = delete;
+		ComplexFft& operator=(const ComplexFft&) = delete;
+	};
+}
@@ -0,0 +1,271 @@
+#include <algorithm>
+#include <cmath>
+
+#include "Decimator.h"
+#include "WindowFunctions.h"
+
+using namespace SpectrogramViewer;
+
+namespace
+{
+	// Stopband attenuation of every stage; the Kaiser window parameters follow from it.
+	const double stopbandDb = 80;
+	const double kaiserBeta = 0.1102 * (stopbandDb - 8.7);
+
+	/** Largest number not above limit with no prime factors other than 2, 3 and 5. */
+	int largestSmoothNumber(int limit)
+	{
+		for (int n = limit; n > 1; n--)
+		{
+			int rest = n;
+
+			for (int prime : { 2, 3, 5 })
+			{
+				while (rest % prime == 0)
+				{
+					rest /= prime;
+				}
+			}
+
+			if (rest == 1)
+			{
+				return n;
+			}
+		}
+
+		return 1;
+	}
+}
+
+void Decimator::prepare(int numChannels_, double inputRate_, double passbandHz, int maxBlockSize)
+{
+	numChannels = numChannels_;
+	numPaddedChannels = (numChannels + CHANNEL_BLOCK - 1) / CHANNEL_BLOCK * CHANNEL_BLOCK;
+
+	if (numChannels < CHANNEL_BLOCK)
+	{
+		numPaddedChannels = 1;
+
+		while (numPaddedChannels < numChannels)
+		{
+			numPaddedChannels *= 2;
+		}
+	}
+	inputRate = inputRate_;
+
+	int maxFactor = std::max(1, (int)std::floor(inputRate / (MIN_OVERSAMPLING * passbandHz)));
+	factor = largestSmoothNumber(maxFactor);
+
+	std::vector<int> stageFactors;
+
+	for (int prime : { 5, 3, 2 })
+	{
+		for (int rest = factor; rest % prime == 0; rest /= prime)
+		{
+			stageFactors.push_back(prime);
+		}
+	}
+
+	stages.clear();
+	double stageRate = inputRate;
+	int stageInputSize = maxBlockSize;
+	int inputSamplesPerStageInput = 1;
+	outputOffset = 0;
+
+	for (auto stageFactor : stageFactors)
+	{
+		// Only the passband has to survive each stage, so the stopband may start
+		// where its alias would fold back onto the passband edge.
+		double outputRate = stageRate / stageFactor;
+		double transitionWidth = (outputRate - 2 * passbandHz) / stageRate;
+		int numTaps = (int)std::ceil((stopbandDb - 7.95) / (14.36 * transitionWidth)) + 1;
+		numTaps |= 1;
+
+		Stage stage;
+		stage.factor = stageFactor;
+		stage.taps = makeLowpassFilter(numTaps, 0.5 / stageFactor, kaiserBeta);
+		stage.buffer.resize((numTaps - 1 + stageInputSize) * numPaddedChannels);
+		stages.push_back(std::move(stage));
+
+		// Output k of a stage has its newest tap on stage input
+		// k * factor + factor - 1 (see reset()), and its centre (numTaps - 1) / 2
+		// before that.
+		outputOffset += inputSamplesPerStageInput * (stageFactor - 1 - (numTaps - 1) / 2);
+		inputSamplesPerStageInput *= stageFactor;
+
+		stageRate = outputRate;
+		stageInputSize = stageInputSize / stageFactor + 1;
+	}
+
+	output.resize(stageInputSize * numPaddedChannels);
+	reset();
+}
+
+void Decimator::reset()
+{
+	for (auto& stage : stages)
+	{
+		std::fill(stage.buffer.begin(), stage.buffer.end(), 0.f);
+		stage.nextOutput = int(stage.taps.size()) - 1 + stage.factor - 1;
+	}
+}
+
+int Decimator::process(const float* const* in, int numSamples, float* const* out)
+{
+	if (stages.empty())
+	{
+		for (int c = 0; c < numChannels; c++)
+		{
+			std::copy(in[c], in[c] + numSamples, out[c]);
+		}
+
+		return numSamples;
+	}
+
+	// Interleave the input right after the first stage's history.
+	int history = int(stages[0].taps.size()) - 1;
+	float* firstInput = &stages[0].buffer[history * numPaddedChannels];
+
+	for (int c = 0; c < numChannels; c++)
+	{
+		for (int i = 0; i < numSamples; i++)
+		{
+			firstInput[i * numPaddedChannels + c] = in[c][i];
+		}
+	}
+
+	// Each stage writes straight after the next stage's history.
+	int numStages = stages.size();
+
+	for (int s = 0; s < numStages; s++)
+	{
+		float* dest = output.data();
+
+		if (s + 1 < numStages)
+		{
+			dest = &stages[s + 1].buffer[(stages[s + 1].taps.size() - 1) * numPaddedChannels];
+		}
+
+		switch (numPaddedChannels)
+		{
+		case 1:
+			numSamples = runSingleChannelStage(stages[s], numSamples, dest);
+			break;
+		case 2:
+			numSamples = runStage<2>(stages[s], numSamples, dest);
+			break;
+		case 4:
+			numSamples = runStage<4>(stages[s], numSamples, dest);
+			break;
+		default:
+			numSamples = runStage<CHANNEL_BLOCK>(stages[s], numSamples, dest);
+			break;
+		}
+	}
+
+	for (int c = 0; c < numChannels; c++)
+	{
+		for (int i = 0; i < numSamples; i++)
+		{
+			out[c][i] = output[i * numPaddedChannels + c];
+		}
+	}
+
+	return numSamples;
+}
+
+template <int blockWidth>
+int Decimator::runStage(Stage& stage, int numSamples, float* dest)
+{
+	const int numTaps = int(stage.taps.size());
+	const int history = numTaps - 1;
+	const int numChannels = numPaddedChannels;
+	const float* taps = stage.taps.data();
+	float* buffer = stage.buffer.data();
+	int numOutputs = 0;
+
+	for (; stage.nextOutput < history + numSamples; stage.nextOutput += stage.factor)
+	{
+		float* acc = dest + numOutputs * numChannels;
+		const float* newest = buffer + stage.nextOutput * numChannels;
+
+		// The block width is fixed at compile time, so the sums of a block stay
+		// in registers across all taps.
+		for (int block = 0; block < numChannels; block += blockWidth)
+		{
+			float sums[blockWidth] = {};
+
+			for (int k = 0; k < numTaps; k++)
+			{
+				const float coefficient = taps[k];
+				const float* source = newest - k * numChannels + block;
+
+				for (int c = 0; c < blockWidth; c++)
+				{
+					sums[c] += coefficient * source[c];
+				}
+			}
+
+			std::copy(sums, sums + blockWidth, acc + block);
+		}
+
+		numOutputs++;
+	}
+
+	// Keep the last numTaps - 1 samples as history for the next call.
+	std::copy(
+		buffer + numSamples * numChannels,
+		buffer + (numSamples + history) * numChannels,
+		buffer);
+	stage.nextOutput -= numSamples;
+
+	return numOutputs;
+}
+
+int Decimator::runSingleChannelStage(Stage& stage, int numSamples, float* dest)
+{
+	const int numTaps = int(stage.taps.size());
+	const int history = numTaps - 1;
+	const float* taps = stage.taps.data();
+	float* buffer = stage.buffer.data();
+	int numOutputs = 0;
+
+	// Independent partial sums let the compiler vectorize the dot product
+	// without reassociating floating-point additions itself.
+	const int numLanes = CHANNEL_BLOCK;
+
+	for (; stage.nextOutput < history + numSamples; stage.nextOutput += stage.factor)
+	{
+		const float* newest = buffer + stage.nextOutput;
+		float partialSums[numLanes] = {};
+		int k = 0;
+
+		for (; k + numLanes <= numTaps; k += numLanes)
+		{
+			for (int lane = 0; lane < numLanes; lane++)
+			{
+				partialSums[lane] += taps[k + lane] * newest[-(k + lane)];
+			}
+		}
+
+		float sum = 0;
+
+		for (; k < numTaps; k++)
+		{
+			sum += taps[k] * newest[-k];
+		}
+
+		for (int lane = 0; lane < numLanes; lane++)
+		{
+			sum += partialSums[lane];
+		}
+
+		dest[numOutputs++] = sum;
+	}
+
+	// Keep the last numTaps - 1 samples as history for the next call.
+	std::copy(buffer + numSamples, buffer + numSamples + history, buffer);
+	stage.nextOutput -= numSamples;
+
+	return numOutputs;
+}
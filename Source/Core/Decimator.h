@@ -0,0 +1,84 @@
+#pragma once
+
+#include <vector>
+
+namespace SpectrogramViewer
+{
+	/** Streaming multistage anti-aliasing decimator for a group of channels.
+
+	prepare() picks the largest total factor (a product of 2s, 3s and 5s) that
+	keeps the output rate at least MIN_OVERSAMPLING times the passband edge,
+	and splits it into one stage per prime factor, largest first. Each stage is
+	a Kaiser-windowed FIR lowpass that is only evaluated at the samples it keeps.
+	Early stages run at high rates but have wide transition bands, so they need
+	few taps; the long filters only run at the lowest rates.
+
+	Samples are kept interleaved by channel, with the channel count padded to a
+	multiple of CHANNEL_BLOCK, so the inner loop of every tap is a contiguous,
+	vectorizable multiply-add over channels. Fewer channels are only padded to
+	the next power of two, so that no lanes are wasted on silence; a single
+	channel is filtered as a plain dot product over the taps instead. Filter
+	state carries over between process() calls until reset().
+	*/
+	class Decimator
+	{
+	public:
+		static constexpr double MIN_OVERSAMPLING = 2.5;
+		static const int CHANNEL_BLOCK = 8;
+
+		/** Designs the stages and allocates all buffers; process() accepts at
+		most maxBlockSize samples per call. */
+		void prepare(int numChannels, double inputRate, double passbandHz, int maxBlockSize);
+
+		int getFactor() const { return factor; }
+		double getOutputRate() const { return inputRate / factor; }
+
+		/** Returns the input sample, counted from the last reset(), that
+		output sample 0 is centred on; output j is centred getFactor() * j
+		samples later. Negative when the filters still see the initial zeros. */
+		int getOutputOffset() const { return outputOffset; }
+
+		/** Returns the number of output samples per channel that a call with
+		numSamples input samples can produce at most. */
+		int getMaxOutputSize(int numSamples) const { return numSamples / factor + 1; }
+
+		/** Filters and decimates numSamples samples of every channel.
+
+		@returns the number of samples written to each out[c].
+		*/
+		int process(const float* const* in, int numSamples, float* const* out);
+
+		/** Clears the filter state, e.g. after a gap in the input. */
+		void reset();
+
+	private:
+		struct Stage
+		{
+			int factor;
+			std::vector<float> taps;
+
+			// numTaps - 1 samples of history followed by the newest input, interleaved.
+			std::vector<float> buffer;
+
+			// Buffer index of the input sample that the next output is aligned with.
+			int nextOutput;
+		};
+
+		std::vector<Stage> stages;
+		std::vector<float> output;
+		int numChannels = 0;
+		int numPaddedChannels = 0;
+		int factor = 1;
+		int outputOffset = 0;
+		double inputRate = 0;
+
+		/** Filters the numSamples samples just placed after the stage's history
+		and writes the outputs, interleaved, to dest, blockWidth channels at a
+		time. Returns the number written. */
+		template <int blockWidth>
+		int runStage(Stage& stage, int numSamples, float* dest);
+
+		/** As runStage(), for a single channel. */
+		int runSingleChannelStage(Stage& stage, int numSamples, float* dest);
+	};
+}
@@ -0,0 +1,51 @@
+#include <cmath>
+
+#include "Heterodyne.h"
+
+using namespace SpectrogramViewer;
+
+void Heterodyne::prepare(double shiftHz, double sampleRate, int maxBlockSize)
+{
+	cyclesPerSample = shiftHz / sampleRate;
+	cosines.resize(maxBlockSize);
+	sines.resize(maxBlockSize);
+	reset();
+}
+
+void Heterodyne::process(
+	const float* const* in,
+	float* const* re,
+	float* const* im,
+	int numChannels,
+	int numSamples)
+{
+	const double twoPi = 2 * 3.14159265358979323846;
+
+	// The phase is tracked in double precision and wrapped every block, so it
+	// doesn't drift however long acquisition runs.
+	for (int i = 0; i < numSamples; i++)
+	{
+		double angle = twoPi * (phase + i * cyclesPerSample);
+		cosines[i] = std::cos(angle);
+		sines[i] = -std::sin(angle);
+	}
+
+	phase += numSamples * cyclesPerSample;
+	phase -= std::floor(phase);
+
+	auto cosValues = cosines.data();
+	auto sinValues = sines.data();
+
+	for (int c = 0; c < numChannels; c++)
+	{
+		auto input = in[c];
+		auto real = re[c];
+		auto imag = im[c];
+
+		for (int i = 0; i < numSamples; i++)
+		{
+			real[i] = input[i] * cosValues[i];
+			imag[i] = input[i] * sinValues[i];
+		}
+	}
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <vector>
+
+namespace SpectrogramViewer
+{
+	/** Shifts a band of real signals down to 0 Hz by complex mixing.
+
+	Every channel is multiplied by exp(-i 2 pi shiftHz t). All channels share
+	one oscillator, whose phase carries over between process() calls, so a
+	block's oscillator values are computed once and reused for every channel.
+	*/
+	class Heterodyne
+	{
+	public:
+		/** Sets the shift and allocates room for blocks of up to maxBlockSize samples. */
+		void prepare(double shiftHz, double sampleRate, int maxBlockSize);
+
+		/** Restarts the oscillator at phase 0. */
+		void reset() { phase = 0; }
+
+		/** Writes the real and imaginary parts of the shifted in[c][0..numSamples)
+		to re[c] and im[c], for numChannels channels. */
+		void process(
+			const float* const* in,
+			float* const* re,
+			float* const* im,
+			int numChannels,
+			int numSamples);
+
+	private:
+		// Oscillator phase in cycles, kept in [0, 1).
+		double phase = 0;
+		double cyclesPerSample = 0;
+
+		std::vector<float> cosines;
+		std::vector<float> sines;
+	};
+}
@@ -0,0 +1,105 @@
+#include <algorithm>
+#include <cmath>
+
+#include "LogFrequencyBins.h"
+
+using namespace SpectrogramViewer;
+
+void LogFrequencyBins::prepare(
+	double firstBinHz, double binSpacingHz, int numInputBins_,
+	double lowHz, double highHz, int numRows_)
+{
+	numInputBins = numInputBins_;
+	numRows = std::max(2, numRows_);
+
+	rowFrequencies.resize(numRows);
+	double rowRatio = std::pow(highHz / lowHz, 1.0 / (numRows - 1));
+
+	for (int r = 0; r < numRows; r++)
+	{
+		rowFrequencies[r] = lowHz * std::pow(rowRatio, r);
+	}
+
+	rowStarts.assign(1, 0);
+	binIndices.clear();
+	weights.clear();
+
+	double halfStep = std::sqrt(rowRatio);
+
+	for (int r = 0; r < numRows; r++)
+	{
+		// Band edges in units of input bins.
+		double centre = (rowFrequencies[r] - firstBinHz) / binSpacingHz;
+		double bandLow = (rowFrequencies[r] / halfStep - firstBinHz) / binSpacingHz;
+		double bandHigh = (rowFrequencies[r] * halfStep - firstBinHz) / binSpacingHz;
+		int rowStart = binIndices.size();
+
+		if (numInputBins == 1)
+		{
+			binIndices.push_back(0);
+			weights.push_back(1);
+		}
+		else if (bandHigh - bandLow < 1)
+		{
+			// Narrower than a bin: interpolate between the bins around the centre.
+			centre = std::min(std::max(centre, 0.0), numInputBins - 1.0);
+			int below = std::min((int)centre, numInputBins - 2);
+			float fraction = centre - below;
+
+			binIndices.push_back(below);
+			weights.push_back(1 - fraction);
+			binIndices.push_back(below + 1);
+			weights.push_back(fraction);
+		}
+		else
+		{
+			// Bin b covers [b - 0.5, b + 0.5); weigh it by its overlap with the band.
+			int firstBin = std::max(0, (int)std::floor(bandLow + 0.5));
+			int lastBin = std::min(numInputBins - 1, (int)std::floor(bandHigh + 0.5));
+			double totalWeight = 0;
+
+			for (int b = firstBin; b <= lastBin; b++)
+			{
+				double overlap = std::min(bandHigh, b + 0.5) - std::max(bandLow, b - 0.5);
+
+				if (overlap > 0)
+				{
+					binIndices.push_back(b);
+					weights.push_back(overlap);
+					totalWeight += overlap;
+				}
+			}
+
+			// The band lies beyond the input bins; use the nearest edge bin.
+			if (totalWeight == 0)
+			{
+				binIndices.push_back(std::min(std::max(0, (int)std::round(centre)), numInputBins - 1));
+				weights.push_back(1);
+				totalWeight = 1;
+			}
+
+			for (int i = rowStart; i < (int)weights.size(); i++)
+			{
+				weights[i] /= totalWeight;
+			}
+		}
+
+		rowStarts.push_back(binIndices.size());
+	}
+}
+
+void LogFrequencyBins::apply(const float* in, float* out) const
+{
+	for (int r = 0; r < numRows; r++)
+	{
+		float power = 0;
+
+		for (int i = rowStarts[r]; i < rowStarts[r + 1]; i++)
+		{
+			float magnitude = in[binIndices[i]];
+			power += weights[i] * magnitude * magnitude;
+		}
+
+		out[r] = std::sqrt(power);
+	}
+}
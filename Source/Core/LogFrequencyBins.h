@@ -0,0 +1,58 @@
+#pragma once
+
+#include <vector>
+
+namespace SpectrogramViewer
+{
+	/** Maps linearly spaced spectrum bins onto log-spaced output rows.
+
+	Row r is centred on lowHz * (highHz / lowHz)^(r / (numRows - 1)) and covers
+	the band between the geometric midpoints to its neighbours. Where that band
+	spans several input bins, the row is their power average, weighted by how
+	much of each bin falls inside the band. Where it is narrower than a bin (at
+	the low end), the row is interpolated between the two bins around its
+	centre. Either way the weights of a row sum to 1, so white noise keeps its
+	level in V/sqrt(Hz).
+
+	The weights are computed once in prepare() and stored as a sparse matrix
+	(compressed rows), so mapping a column costs one multiply-add per stored
+	weight: about the number of input bins plus two per row.
+	*/
+	class LogFrequencyBins
+	{
+	public:
+		/** Precomputes the weights.
+
+		@param firstBinHz   frequency of input bin 0.
+		@param binSpacingHz frequency step between input bins.
+		@param numInputBins number of input bins per column.
+		@param lowHz        centre of the lowest output row; must be above 0.
+		@param highHz       centre of the highest output row.
+		@param numRows      number of output rows; at least 2.
+		*/
+		void prepare(
+			double firstBinHz, double binSpacingHz, int numInputBins,
+			double lowHz, double highHz, int numRows);
+
+		int getNumInputBins() const { return numInputBins; }
+		int getNumRows() const { return numRows; }
+
+		/** Returns the centre frequency of the given output row. */
+		double getRowFrequency(int row) const { return rowFrequencies[row]; }
+
+		/** Maps one column of magnitudes, in[0..getNumInputBins()), to
+		out[0..getNumRows()). in and out must not overlap. */
+		void apply(const float* in, float* out) const;
+
+	private:
+		int numInputBins = 0;
+		int numRows = 0;
+
+		std::vector<double> rowFrequencies;
+
+		// Row r uses the weights and input bins at [rowStarts[r], rowStarts[r + 1]).
+		std::vector<int> rowStarts;
+		std::vector<int> binIndices;
+		std::vector<float> weights;
+	};
+}
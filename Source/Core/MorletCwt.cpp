@@ -0,0 +1,278 @@
+#include <algorithm>
+#include <cmath>
+
+#include "pocketfft_hdronly.h"
+#include "MorletCwt.h"
+
+using namespace SpectrogramViewer;
+
+namespace
+{
+	using pocketfft::detail::arr;
+	using pocketfft::detail::cmplx;
+
+	const double pi = 3.14159265358979323846;
+
+	// Kernels are cut off this many standard deviations from their centre,
+	// in time and in frequency.
+	const double kernelExtentSigmas = 4;
+}
+
+struct MorletCwt::Plan
+{
+	Plan(int length) : fft(length), blockSpectrum(length) {}
+
+	pocketfft::detail::pocketfft_c<float> fft;
+
+	// Spectrum of the current block of one channel, shared by all scales.
+	arr<cmplx<float>> blockSpectrum;
+};
+
+struct MorletCwt::Workspace
+{
+	Workspace(int length) : data(length), scratch(length) {}
+
+	arr<cmplx<float>> data;
+	arr<cmplx<float>> scratch;
+};
+
+MorletCwt::MorletCwt()
+{
+}
+
+MorletCwt::~MorletCwt()
+{
+}
+
+void MorletCwt::prepare(
+	int numChannels_,
+	double sampleRate,
+	double minFrequency,
+	double maxFrequency,
+	int numScales_,
+	double numCycles,
+	int hopLength_,
+	int numThreads)
+{
+	numChannels = numChannels_;
+	numScales = std::max(1, numScales_);
+	hopLength = std::max(1, hopLength_);
+
+	scaleFrequencies.resize(numScales);
+
+	for (int s = 0; s < numScales; s++)
+	{
+		double fraction = (numScales > 1) ? double(s) / (numScales - 1) : 0;
+		scaleFrequencies[s] = minFrequency * std::pow(maxFrequency / minFrequency, fraction);
+	}
+
+	// The longest kernel belongs to the lowest frequency. Make the FFT at least
+	// four kernels long, so that at least half of every block is valid output.
+	double lowestTimeSigma = numCycles / (2 * pi * minFrequency);
+	kernelHalfLength = (int)std::ceil(kernelExtentSigmas * lowestTimeSigma * sampleRate);
+	fftLength = (int)pocketfft::detail::util::good_size_cmplx(4 * kernelHalfLength + 2);
+	blockLength = fftLength - 2 * kernelHalfLength;
+
+	// The analytic Morlet kernel is a Gaussian around the scale's frequency in
+	// the spectrum. A peak gain of 2 makes the magnitude of the output equal the
+	// amplitude of a real sinusoid at that frequency.
+	kernelSpectra.assign(numScales, std::vector<float>(fftLength, 0.f));
+	firstBins.resize(numScales);
+	lastBins.resize(numScales);
+	densityScaling.resize(numScales);
+
+	double binWidth = sampleRate / fftLength;
+
+	for (int s = 0; s < numScales; s++)
+	{
+		double frequency = scaleFrequencies[s];
+		double frequencySigma = frequency / numCycles;
+		int first = std::max(1, (int)std::floor((frequency - kernelExtentSigmas * frequencySigma) / binWidth));
+		int last = std::min(fftLength / 2, (int)std::ceil((frequency + kernelExtentSigmas * frequencySigma) / binWidth) + 1);
+
+		for (int bin = first; bin < last; bin++)
+		{
+			double offset = (bin * binWidth - frequency) / frequencySigma;
+			kernelSpectra[s][bin] = float(2 * std::exp(-offset * offset / 2) / fftLength);
+		}
+
+		firstBins[s] = first;
+		lastBins[s] = last;
+
+		// With that gain, white noise of one-sided density S comes out with power
+		// 2 sqrt(pi) frequencySigma S.
+		densityScaling[s] = float(1 / std::sqrt(2 * std::sqrt(pi) * frequencySigma));
+	}
+
+	plan.reset(new Plan(fftLength));
+	workspaces.clear();
+
+	for (int i = 0; i < std::max(1, numThreads); i++)
+	{
+		workspaces.emplace_back(new Workspace(fftLength));
+	}
+
+	inputs.assign(numChannels * fftLength, 0);
+	blockPowers.assign(numScales * blockLength, 0);
+	hopPowers.assign(numChannels * numScales, 0);
+
+	maxColumns = blockLength / hopLength + 2;
+	columns.assign(numChannels * maxColumns * numScales, 0);
+	reset();
+}
+
+void MorletCwt::reset()
+{
+	// The first block is zero-padded on the left, like the first STFT frame.
+	std::fill(inputs.begin(), inputs.end(), 0.f);
+	std::fill(hopPowers.begin(), hopPowers.end(), 0.0);
+	inputFill = 2 * kernelHalfLength;
+	hopFill = 0;
+	numReadyColumns = 0;
+	numReadColumns = 0;
+}
+
+int MorletCwt::append(const float* const* in, int numSamples)
+{
+	int numConsumed = std::min(numSamples, fftLength - inputFill);
+
+	for (int c = 0; c < numChannels; c++)
+	{
+		std::copy(in[c], in[c] + numConsumed, &inputs[c * fftLength + inputFill]);
+	}
+
+	inputFill += numConsumed;
+
+	if (inputFill == fftLength)
+	{
+		processBlock();
+
+		// Overlap-save: the next block starts blockLength samples later.
+		for (int c = 0; c < numChannels; c++)
+		{
+			auto input = &inputs[c * fftLength];
+			std::copy(input + blockLength, input + fftLength, input);
+		}
+
+		inputFill = fftLength - blockLength;
+	}
+
+	return numConsumed;
+}
+
+void MorletCwt::readColumn(float* const* out, float scalingFactor)
+{
+	int slot = int(numReadColumns % maxColumns);
+
+	for (int c = 0; c < numChannels; c++)
+	{
+		auto column = &columns[(c * maxColumns + slot) * numScales];
+
+		for (int s = 0; s < numScales; s++)
+		{
+			out[c][s] = column[s] * scalingFactor;
+		}
+	}
+
+	numReadColumns++;
+}
+
+void MorletCwt::processBlock()
+{
+	bool forward = true;
+	int numThreads = std::min(getNumThreads(), numScales);
+	auto spectrum = workspaces[0]->data.data();
+	auto blockSpectrum = plan->blockSpectrum.data();
+
+	for (int c = 0; c < numChannels; c++)
+	{
+		auto input = &inputs[c * fftLength];
+
+		for (int i = 0; i < fftLength; i++)
+		{
+			spectrum[i] = cmplx<float>(input[i], 0);
+		}
+
+		// Only the positive frequencies are used, since the kernels are analytic.
+		plan->fft.exec(spectrum, 1.f, forward, workspaces[0]->scratch.data());
+		std::copy(spectrum, spectrum + fftLength, blockSpectrum);
+
+		auto convolveScales = [&](int threadIndex, int fromScale, int toScale)
+		{
+			auto& workspace = *workspaces[threadIndex];
+			auto data = workspace.data.data();
+
+			for (int s = fromScale; s < toScale; s++)
+			{
+				auto& kernel = kernelSpectra[s];
+				std::fill(data, data + fftLength, cmplx<float>(0, 0));
+
+				for (int bin = firstBins[s]; bin < lastBins[s]; bin++)
+				{
+					data[bin] = blockSpectrum[bin] * kernel[bin];
+				}
+
+				plan->fft.exec(data, 1.f, !forward, workspace.scratch.data());
+
+				// Outputs that the centred kernel computed without wrapping around.
+				auto powers = &blockPowers[s * blockLength];
+
+				for (int i = 0; i < blockLength; i++)
+				{
+					auto value = data[kernelHalfLength + i];
+					powers[i] = value.r * value.r + value.i * value.i;
+				}
+			}
+		};
+
+		if (numThreads <= 1)
+		{
+			convolveScales(0, 0, numScales);
+		}
+		else
+		{
+			pocketfft::detail::threading::thread_map(numThreads, [&]
+			{
+				int threadIndex = pocketfft::detail::threading::thread_id();
+				convolveScales(
+					threadIndex,
+					numScales * threadIndex / numThreads,
+					numScales * (threadIndex + 1) / numThreads);
+			});
+		}
+
+		// Downsample to columns. Every channel sees the same hop boundaries, so
+		// the channel's columns land in the same ring slots as everyone else's.
+		auto channelHopPowers = &hopPowers[c * numScales];
+		int fill = hopFill;
+		long long columnNumber = numReadyColumns;
+
+		for (int i = 0; i < blockLength; i++)
+		{
+			for (int s = 0; s < numScales; s++)
+			{
+				channelHopPowers[s] += blockPowers[s * blockLength + i];
+			}
+
+			if (++fill == hopLength)
+			{
+				auto column = &columns[(c * maxColumns + columnNumber % maxColumns) * numScales];
+
+				for (int s = 0; s < numScales; s++)
+				{
+					column[s] = float(std::sqrt(channelHopPowers[s] / hopLength)) * densityScaling[s];
+					channelHopPowers[s] = 0;
+				}
+
+				fill = 0;
+				columnNumber++;
+			}
+		}
+
+		if (c == numChannels - 1)
+		{
+			hopFill = fill;
+			numReadyColumns = columnNumber;
+		}
+	}
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+namespace SpectrogramViewer
+{
+	/** Streaming Morlet continuous wavelet transform of a group of channels.
+
+	Scales are log-spaced from minFrequency to maxFrequency. Each channel is
+	convolved with every Morlet kernel by overlap-save: a block of fftLength
+	samples is transformed once, multiplied by each scale's kernel spectrum
+	and transformed back, and the fftLength - 2 * kernelHalfLength outputs
+	that don't wrap around are kept. The kernel spectra are Gaussians and are
+	computed once in prepare(). The scales of a block are spread across
+	numThreads threads.
+
+	The output is downsampled to one column per hopLength samples, with the
+	RMS magnitude of each scale over the hop, and scaled to an amplitude
+	spectral density in the input's units per sqrt(Hz). Row 0 is the lowest
+	frequency. The kernels are centred, so columns lag the input by
+	getLatency() samples.
+	*/
+	class MorletCwt
+	{
+	public:
+		MorletCwt();
+		~MorletCwt();
+
+		void prepare(
+			int numChannels,
+			double sampleRate,
+			double minFrequency,
+			double maxFrequency,
+			int numScales,
+			double numCycles,
+			int hopLength,
+			int numThreads = 1);
+
+		int getNumScales() const { return numScales; }
+		int getFftLength() const { return fftLength; }
+		int getLatency() const { return kernelHalfLength; }
+		int getNumThreads() const { return int(workspaces.size()); }
+
+		/** Returns the centre frequency of the given scale, in Hz. */
+		double getScaleFrequency(int scale) const { return scaleFrequencies[scale]; }
+
+		/** Appends up to numSamples samples of every channel, stopping after the
+		first block that completes. Returns the number of samples consumed. */
+		int append(const float* const* in, int numSamples);
+
+		/** Returns the number of columns computed but not read yet. */
+		int getNumReadyColumns() const { return numReadyColumns - numReadColumns; }
+
+		/** Copies the oldest ready column of every channel, multiplied by
+		scalingFactor, into out[c] and drops it. */
+		void readColumn(float* const* out, float scalingFactor);
+
+		/** Clears all buffered input and output, e.g. after a gap in the input. */
+		void reset();
+
+	private:
+		struct Plan;
+		struct Workspace;
+
+		std::unique_ptr<Plan> plan;
+		std::vector<std::unique_ptr<Workspace>> workspaces;
+
+		int numChannels = 0;
+		int numScales = 0;
+		int hopLength = 1;
+		int fftLength = 0;
+		int kernelHalfLength = 0;
+		int blockLength = 0;
+
+		std::vector<double> scaleFrequencies;
+
+		// Gain per scale that turns the RMS magnitude into a spectral density.
+		std::vector<float> densityScaling;
+
+		// Kernel spectrum of each scale; only the bins in [firstBin, lastBin) are nonzero.
+		std::vector<std::vector<float>> kernelSpectra;
+		std::vector<int> firstBins;
+		std::vector<int> lastBins;
+
+		// The last fftLength input samples of every channel; inputFill are valid.
+		std::vector<float> inputs;
+		int inputFill = 0;
+
+		// Squared magnitudes of the current block, one row of blockLength per scale.
+		std::vector<float> blockPowers;
+
+		// Power summed over the current hop, per channel and scale.
+		std::vector<double> hopPowers;
+		int hopFill = 0;
+
+		// Ready columns, per channel: numScales values each, in a ring of maxColumns.
+		std::vector<float> columns;
+		int maxColumns = 0;
+		long long numReadyColumns = 0;
+		long long numReadColumns = 0;
+
+		void processBlock();
+	};
+}
@@ -0,0 +1,311 @@
+#include <algorithm>
+#include <cmath>
+
+#include "pocketfft_hdronly.h"
+#include "RealFft.h"
+#include "SimdKernels.h"
+
+using namespace SpectrogramViewer;
+
+namespace
+{
+	using pocketfft::detail::arr;
+
+	const int vectorLength = pocketfft::detail::VLEN<float>::val;
+
+#ifndef POCKETFFT_NO_VECTORS
+	using FloatVector = pocketfft::detail::vtype_t<float>;
+#endif
+}
+
+struct RealFft::Plan
+{
+	Plan(int length) : fft(length) {}
+
+	pocketfft::detail::pocketfft_r<float> fft;
+};
+
+struct RealFft::Workspace
+{
+	Workspace(int length)
+		: data(length), scratch(length)
+#ifndef POCKETFFT_NO_VECTORS
+		, vectorData(length), vectorScratch(length), lane(length)
+#endif
+	{}
+
+	// All arrays are 64-byte aligned by pocketfft.
+	arr<float> data;
+	arr<float> scratch;
+
+#ifndef POCKETFFT_NO_VECTORS
+	arr<FloatVector> vectorData;
+	arr<FloatVector> vectorScratch;
+
+	// One transform's result, copied out of vectorData.
+	arr<float> lane;
+#endif
+};
+
+RealFft::RealFft()
+{
+}
+
+RealFft::~RealFft()
+{
+}
+
+double RealFft::estimateCost(int length)
+{
+	using pocketfft::detail::util;
+
+	if (length < 2)
+	{
+		return 0;
+	}
+
+	// pocketfft_r's choice of algorithm, in its own units: n log2(n) for a
+	// power of two.
+	double mixedRadixCost = 0.5 * util::cost_guess(length);
+	size_t largestFactor = (length < 50) ? 0 : util::largest_prime_factor(length);
+	double cost = mixedRadixCost;
+
+	if (largestFactor * largestFactor > size_t(length))
+	{
+		double bluesteinCost = 2 * util::cost_guess(util::good_size_cmplx(2 * length - 1));
+
+		if (1.5 * bluesteinCost < mixedRadixCost)
+		{
+			cost = bluesteinCost;
+		}
+	}
+
+	return COST_PER_LOG2 * cost;
+}
+
+int RealFft::getFastLength(int minLength)
+{
+	return int(pocketfft::detail::util::good_size_real(std::max(1, minLength)));
+}
+
+void RealFft::prepare(int newLength, int numThreads, int newInputLength)
+{
+	numThreads = std::max(1, numThreads);
+	newInputLength = (newInputLength > 0) ? std::min(newInputLength, newLength) : newLength;
+
+	if (newLength == length && newInputLength == inputLength && numThreads == getNumThreads() && plan)
+	{
+		return;
+	}
+
+	plan.reset(new Plan(newLength));
+	workspaces.clear();
+
+	for (int i = 0; i < numThreads; i++)
+	{
+		workspaces.emplace_back(new Workspace(newLength));
+	}
+
+	windows.assign(1, std::vector<float>(newInputLength, 1.f));
+	length = newLength;
+	inputLength = newInputLength;
+}
+
+void RealFft::setWindow(const std::vector<float>& newWindow)
+{
+	setWindows({ newWindow });
+}
+
+void RealFft::setWindows(const std::vector<std::vector<float>>& newWindows)
+{
+	if (newWindows.empty())
+	{
+		return;
+	}
+
+	windows.assign(newWindows.size(), std::vector<float>(inputLength, 0.f));
+
+	for (int w = 0; w < (int)newWindows.size(); w++)
+	{
+		auto& newWindow = newWindows[w];
+		std::copy(newWindow.begin(), newWindow.begin() + std::min<size_t>(inputLength, newWindow.size()), windows[w].begin());
+	}
+}
+
+void RealFft::calcMagnitudes(const float* in, float* out, int numBins, float scalingFactor)
+{
+	calcBlock(*workspaces[0], &in, &out, 1, numBins, scalingFactor);
+}
+
+void RealFft::calcMagnitudes(
+	const float* const* in,
+	float* const* out,
+	int numTransforms,
+	int numBins,
+	float scalingFactor)
+{
+	int numBlocks = (numTransforms + vectorLength - 1) / vectorLength;
+	int numThreads = std::min(getNumThreads(), numBlocks);
+
+	if (numThreads <= 1)
+	{
+		calcBlock(*workspaces[0], in, out, numTransforms, numBins, scalingFactor);
+		return;
+	}
+
+	// Hand out whole vector blocks so every thread keeps its SIMD lanes full.
+	pocketfft::detail::threading::thread_map(numThreads, [&]
+	{
+		int threadIndex = pocketfft::detail::threading::thread_id();
+		int fromBlock = numBlocks * threadIndex / numThreads;
+		int toBlock = numBlocks * (threadIndex + 1) / numThreads;
+		int fromTransform = fromBlock * vectorLength;
+		int toTransform = std::min(numTransforms, toBlock * vectorLength);
+
+		calcBlock(
+			*workspaces[threadIndex],
+			in + fromTransform,
+			out + fromTransform,
+			toTransform - fromTransform,
+			numBins,
+			scalingFactor);
+	});
+}
+
+void RealFft::calcBlock(
+	Workspace& workspace,
+	const float* const* in,
+	float* const* out,
+	int numTransforms,
+	int numBins,
+	float scalingFactor)
+{
+	bool forward = true;
+	int numComputedBins = std::min(numBins, length / 2 + 1);
+	int numWindows = int(windows.size());
+	auto& kernels = getSimdKernels();
+
+	// Results are in FFTPACK half-complex order: r0, then (re, im) pairs for
+	// bins 1 to (length - 1) / 2, then r(length / 2) if the length is even.
+	int numPairs = std::max(0, std::min(numComputedBins - 1, (length - 1) / 2));
+	bool hasNyquist = length % 2 == 0 && numComputedBins > length / 2;
+
+	// Every input is transformed once per window; item n is input n / numWindows
+	// under window n % numWindows. With several windows (multitaper), the power
+	// spectra of an input are summed in its output column and turned into the
+	// RMS magnitude at the end, so no per-window spectra are stored.
+	int numItems = numTransforms * numWindows;
+	int item = 0;
+	bool averaging = numWindows > 1;
+
+	// The scaling is applied as the magnitudes are computed, rather than by
+	// pocketfft in a pass of its own.
+	const float factor = 1.f;
+
+	auto storeResult = [&](const float* result, float* outColumn)
+	{
+		if (averaging)
+		{
+			outColumn[0] += result[0] * result[0];
+			kernels.accumulateComplexPowers(result + 1, outColumn + 1, numPairs);
+
+			if (hasNyquist)
+			{
+				outColumn[length / 2] += result[length - 1] * result[length - 1];
+			}
+		}
+		else
+		{
+			outColumn[0] = std::abs(result[0]) * scalingFactor;
+			kernels.complexMagnitudes(result + 1, outColumn + 1, numPairs, scalingFactor);
+
+			if (hasNyquist)
+			{
+				outColumn[length / 2] = std::abs(result[length - 1]) * scalingFactor;
+			}
+		}
+	};
+
+	if (averaging)
+	{
+		for (int transform = 0; transform < numTransforms; transform++)
+		{
+			std::fill(out[transform], out[transform] + numComputedBins, 0.f);
+		}
+	}
+
+#ifndef POCKETFFT_NO_VECTORS
+	auto vectorData = workspace.vectorData.data();
+	const float* laneInputs[vectorLength];
+	const float* laneWindows[vectorLength];
+
+	for (; item + vectorLength <= numItems; item += vectorLength)
+	{
+		for (int j = 0; j < vectorLength; j++)
+		{
+			laneInputs[j] = in[(item + j) / numWindows];
+			laneWindows[j] = windows[(item + j) % numWindows].data();
+		}
+
+		for (int i = 0; i < inputLength; i++)
+		{
+			for (int j = 0; j < vectorLength; j++)
+			{
+				vectorData[i][j] = laneInputs[j][i] * laneWindows[j][i];
+			}
+		}
+
+		for (int i = inputLength; i < length; i++)
+		{
+			for (int j = 0; j < vectorLength; j++)
+			{
+				vectorData[i][j] = 0;
+			}
+		}
+
+		plan->fft.exec(vectorData, factor, forward, workspace.vectorScratch.data());
+
+		auto lane = workspace.lane.data();
+
+		for (int j = 0; j < vectorLength; j++)
+		{
+			for (int i = 0; i < length; i++)
+			{
+				lane[i] = vectorData[i][j];
+			}
+
+			storeResult(lane, out[(item + j) / numWindows]);
+		}
+	}
+#endif
+
+	// Whatever doesn't fill a vector goes through the scalar path.
+	auto data = workspace.data.data();
+
+	for (; item < numItems; item++)
+	{
+		auto input = in[item / numWindows];
+		auto windowValues = windows[item % numWindows].data();
+
+		kernels.multiply(input, windowValues, data, inputLength);
+		std::fill(data + inputLength, data + length, 0.f);
+
+		plan->fft.exec(data, factor, forward, workspace.scratch.data());
+		storeResult(data, out[item / numWindows]);
+	}
+
+	for (int transform = 0; transform < numTransforms; transform++)
+	{
+		auto outColumn = out[transform];
+
+		if (averaging)
+		{
+			for (int i = 0; i < numComputedBins; i++)
+			{
+				outColumn[i] = std::sqrt(outColumn[i] / numWindows) * scalingFactor;
+			}
+		}
+
+		std::fill(outColumn + numComputedBins, outColumn + numBins, 0.f);
+	}
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+namespace SpectrogramViewer
+{
+	/** Magnitude spectra of real signals, computed with a persistent pocketfft plan.
+
+	All allocation and twiddle factor setup happens in prepare(). After that,
+	calcMagnitudes() works entirely in preallocated buffers, so it is safe to call
+	from the audio thread (with a single thread; see prepare()).
+
+	Batches of transforms are interleaved into pocketfft's SIMD vector type and run
+	VLEN at a time through one plan, which is how pocketfft vectorizes its own
+	multi-transform r2c() calls, minus the per-call plan and buffer allocation.
+	*/
+	class RealFft
+	{
+	public:
+		RealFft();
+		~RealFft();
+
+		/** Cost model: about COST_PER_LOG2 nanoseconds per sample per log2(length)
+		for lengths with small prime factors, measured with 64 channels on a
+		3 GHz x86-64 at -O2. */
+		static constexpr double COST_PER_LOG2 = 0.4;
+
+		/** Returns the expected time of one transform of the given length, in
+		nanoseconds. Follows pocketfft's own cost model and its choice between
+		the mixed-radix and Bluestein algorithms, so lengths with large prime
+		factors come out as slow as they are. */
+		static double estimateCost(int length);
+
+		/** Returns the smallest length of at least minLength whose only prime
+		factors are 2, 3 and 5, which pocketfft transforms fastest. */
+		static int getFastLength(int minLength);
+
+		/** Builds the plan and the working buffers for transforms of the given length.
+
+		Batches are split across numThreads threads from pocketfft's thread pool.
+		With more than one thread the calling thread waits for the pool to finish,
+		so keep numThreads at 1 on threads that must never block.
+
+		Inputs are inputLength samples long and zero-padded to the transform
+		length; 0 means the transform length.
+		*/
+		void prepare(int length, int numThreads = 1, int inputLength = 0);
+
+		/** Returns the transform length set by prepare(), or 0 if not prepared. */
+		int getLength() const { return length; }
+
+		int getInputLength() const { return inputLength; }
+
+		int getNumThreads() const { return int(workspaces.size()); }
+
+		/** Sets the window that inputs are multiplied by as they are copied into
+		the transform buffer. Must have getInputLength() values; prepare() resets
+		it to a rectangular window when the length changes.
+		*/
+		void setWindow(const std::vector<float>& newWindow);
+
+		/** Sets several windows, e.g. the tapers of a multitaper estimate. Every
+		input is then transformed under each window, and its output is the RMS
+		over windows of the magnitudes, i.e. the square root of the averaged
+		power spectra.
+		*/
+		void setWindows(const std::vector<std::vector<float>>& newWindows);
+
+		int getNumWindows() const { return int(windows.size()); }
+
+		/** Computes the first numBins magnitudes of the FFT of the windowed in[0..getInputLength()),
+		zero-padded to getLength().
+
+		Every output is multiplied by scalingFactor. Bins above Nyquist are set to 0.
+		*/
+		void calcMagnitudes(const float* in, float* out, int numBins, float scalingFactor);
+
+		/** Same as above, for numTransforms independent inputs and outputs. */
+		void calcMagnitudes(
+			const float* const* in,
+			float* const* out,
+			int numTransforms,
+			int numBins,
+			float scalingFactor);
+
+	private:
+		struct Plan;
+		struct Workspace;
+
+		std::unique_ptr<Plan> plan;
+		std::vector<std::unique_ptr<Workspace>> workspaces;
+		std::vector<std::vector<float>> windows;
+		int length = 0;
+		int inputLength = 0;
+
+		void calcBlock(
+			Workspace& workspace,
+			const float* const* in,
+			float* const* out,
+			int numTransforms,
+			int numBins,
+			float scalingFactor);
+
+		RealFft(const RealFft&) = delete;
+		RealFft& operator=(const RealFft&) = delete;
+	};
+}
@@ -0,0 +1,79 @@
+#include <algorithm>
+
+#include "SampleFifo.h"
+
+using namespace SpectrogramViewer;
+
+void SampleFifo::resize(int numChannels_, int capacity_)
+{
+	numChannels = numChannels_;
+	capacity = capacity_;
+	samples.assign(numChannels * capacity, 0);
+	writePosition.store(0);
+	readPosition.store(0);
+}
+
+int SampleFifo::getNumReady() const
+{
+	return int(writePosition.load(std::memory_order_acquire) - readPosition.load(std::memory_order_acquire));
+}
+
+int SampleFifo::write(const float* const* channels, int numSamples)
+{
+	int64_t position = writePosition.load(std::memory_order_relaxed);
+	int numFree = capacity - int(position - readPosition.load(std::memory_order_acquire));
+	numSamples = std::min(numSamples, numFree);
+
+	if (numSamples <= 0)
+	{
+		return 0;
+	}
+
+	int start = position % capacity;
+	int firstPart = std::min(numSamples, capacity - start);
+
+	for (int c = 0; c < numChannels; c++)
+	{
+		auto channelStorage = &samples[c * capacity];
+		std::copy(channels[c], channels[c] + firstPart, channelStorage + start);
+		std::copy(channels[c] + firstPart, channels[c] + numSamples, channelStorage);
+	}
+
+	writePosition.store(position + numSamples, std::memory_order_release);
+	return numSamples;
+}
+
+int SampleFifo::read(float* const* destinations, int numSamples)
+{
+	int64_t position = readPosition.load(std::memory_order_relaxed);
+	int numReady = int(writePosition.load(std::memory_order_acquire) - position);
+	numSamples = std::min(numSamples, numReady);
+
+	if (numSamples <= 0)
+	{
+		return 0;
+	}
+
+	int start = position % capacity;
+	int firstPart = std::min(numSamples, capacity - start);
+
+	for (int c = 0; c < numChannels; c++)
+	{
+		auto channelStorage = &samples[c * capacity];
+		std::copy(channelStorage + start, channelStorage + start + firstPart, destinations[c]);
+		std::copy(channelStorage, channelStorage + numSamples - firstPart, destinations[c] + firstPart);
+	}
+
+	readPosition.store(position + numSamples, std::memory_order_release);
+	return numSamples;
+}
+
+int SampleFifo::skip(int numSamples)
+{
+	int64_t position = readPosition.load(std::memory_order_relaxed);
+	int numReady = int(writePosition.load(std::memory_order_acquire) - position);
+	numSamples = std::max(0, std::min(numSamples, numReady));
+
+	readPosition.store(position + numSamples, std::memory_order_release);
+	return numSamples;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace SpectrogramViewer
+{
+	/** Lock-free single-producer / single-consumer FIFO of multi-channel samples.
+
+	The writer and the reader each own one position counter; neither ever waits
+	for the other. All channels move in lockstep. resize() must not run while
+	either side is active.
+	*/
+	class SampleFifo
+	{
+	public:
+		/** Allocates room for capacity samples per channel and empties the FIFO. */
+		void resize(int numChannels, int capacity);
+
+		int getNumChannels() const { return numChannels; }
+		int getCapacity() const { return capacity; }
+
+		/** Returns the number of samples per channel waiting to be read. */
+		int getNumReady() const;
+
+		/** Appends up to numSamples samples of each channel from channels[c].
+
+		@returns the number of samples written, which is less than numSamples
+		if the FIFO is full.
+		*/
+		int write(const float* const* channels, int numSamples);
+
+		/** Moves up to numSamples samples of each channel into destinations[c].
+
+		@returns the number of samples read.
+		*/
+		int read(float* const* destinations, int numSamples);
+
+		/** Discards up to numSamples of the oldest samples. Reader side only.
+
+		@returns the number of samples discarded.
+		*/
+		int skip(int numSamples);
+
+	private:
+		std::vector<float> samples;
+		int numChannels = 0;
+		int capacity = 0;
+
+		// Total samples written and read since resize(); the sample with
+		// position n is stored at n % capacity.
+		std::atomic<int64_t> writePosition { 0 };
+		std::atomic<int64_t> readPosition { 0 };
+	};
+}
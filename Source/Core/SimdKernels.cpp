@@ -0,0 +1,844 @@
+#include <cmath>
+#include <cstring>
+
+#include "SimdKernels.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SIMD_KERNELS_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#else
+#define SIMD_KERNELS_X86 0
+#endif
+
+#if SIMD_KERNELS_X86 && (defined(__GNUC__) || defined(__clang__))
+#define SIMD_TARGET(isa) __attribute__((target(isa)))
+#else
+#define SIMD_TARGET(isa)
+#endif
+
+using namespace SpectrogramViewer;
+
+namespace
+{
+	const float decibelsPerLog2OfPower = 3.01029995664f;   // 10 log10(2)
+	const float log10Of2 = 0.30102999566f;
+
+	/** log2 of the float with the given bit pattern, accurate to about 2e-6.
+
+	Splits the value into exponent and mantissa, moves the mantissa into
+	[sqrt(1/2), sqrt(2)), and evaluates log2(m) = 2 / ln(2) * atanh((m - 1) / (m + 1))
+	with a short series. There are no branches or float compares, so the loop
+	calling this vectorizes without -fno-trapping-math. Zero and denormals give about -127,
+	infinity gives 128. The result for NaN is meaningless.
+	*/
+	inline float fastLog2(int32_t bits)
+	{
+		int32_t exponent = ((bits >> 23) & 0xff) - 127;
+		int32_t mantissaBits = (bits & 0x007fffff) | 0x3f800000;
+
+		// 0x3fb504f3 is sqrt(2); halve larger mantissas by decrementing their exponent.
+		// The sign bit of the difference is the comparison result, without a branch.
+		int32_t isLarge = int32_t(uint32_t(0x3fb504f3 - mantissaBits) >> 31);
+		mantissaBits -= isLarge << 23;
+		exponent += isLarge;
+
+		float mantissa;
+		std::memcpy(&mantissa, &mantissaBits, sizeof(mantissa));
+
+		float t = (mantissa - 1) / (mantissa + 1);
+		float t2 = t * t;
+		float series = t * (2.88539008f + t2 * (0.96179669f + t2 * 0.57707801f));
+
+		return float(exponent) + series;
+	}
+
+	inline float fastLog2(float value)
+	{
+		int32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		return fastLog2(bits);
+	}
+
+	// Generic kernels, also used for the tails of the SIMD ones.
+
+	void complexMagnitudesGeneric(const float* z, float* out, int n, float scale)
+	{
+		for (int i = 0; i < n; i++)
+		{
+			float re = z[2 * i];
+			float im = z[2 * i + 1];
+			out[i] = scale * std::sqrt(re * re + im * im);
+		}
+	}
+
+	void complexDecibelsGeneric(const float* z, float* out, int n, float scale)
+	{
+		float scale2 = scale * scale;
+
+		for (int i = 0; i < n; i++)
+		{
+			float re = z[2 * i];
+			float im = z[2 * i + 1];
+			out[i] = decibelsPerLog2OfPower * fastLog2(scale2 * (re * re + im * im));
+		}
+	}
+
+	void accumulateComplexPowersGeneric(const float* z, float* out, int n)
+	{
+		for (int i = 0; i < n; i++)
+		{
+			float re = z[2 * i];
+			float im = z[2 * i + 1];
+			out[i] += re * re + im * im;
+		}
+	}
+
+	void toDecibelsGeneric(const float* in, float* out, int n, float scale, float decibelsPerDecade)
+	{
+		float decibelsPerLog2 = decibelsPerDecade * log10Of2;
+
+		for (int i = 0; i < n; i++)
+		{
+			// Keep NaN (no data) as it is.
+			float value = scale * in[i];
+			out[i] = (value == value) ? decibelsPerLog2 * fastLog2(value) : value;
+		}
+	}
+
+	void multiplyGeneric(const float* in, const float* window, float* out, int n)
+	{
+		for (int i = 0; i < n; i++)
+		{
+			out[i] = in[i] * window[i];
+		}
+	}
+
+	void logQuantizeGeneric(const float* in, uint8_t* levels, int n, float gain, float offset, int maxLevel)
+	{
+		for (int i = 0; i < n; i++)
+		{
+			int32_t bits;
+			std::memcpy(&bits, &in[i], sizeof(bits));
+
+			// Treat NaN (no data) as zero so that it lands on level 0.
+			int32_t isNaN = int32_t(uint32_t(0x7f800000 - (bits & 0x7fffffff)) >> 31);
+			bits &= isNaN - 1;
+
+			// |log2| is at most about 150 here, so the conversion cannot overflow.
+			int32_t level = int32_t(fastLog2(bits) * gain + offset);
+			level = level > 0 ? level : 0;
+			level = level < maxLevel ? level : maxLevel;
+			levels[i] = uint8_t(level);
+		}
+	}
+
+	void quantizeGeneric(const float* in, uint8_t* levels, int n, float gain, float offset, int maxLevel)
+	{
+		for (int i = 0; i < n; i++)
+		{
+			// NaN fails the first comparison and lands on level 0.
+			float level = in[i] * gain + offset;
+			level = level > 0 ? level : 0;
+			level = level < maxLevel ? level : maxLevel;
+			levels[i] = uint8_t(level);
+		}
+	}
+
+	void quantize16Generic(const float* in, uint16_t* levels, int n, float gain, float offset, int maxLevel)
+	{
+		for (int i = 0; i < n; i++)
+		{
+			float level = in[i] * gain + offset;
+			level = level > 0 ? level : 0;
+			level = level < maxLevel ? level : maxLevel;
+			levels[i] = uint16_t(level);
+		}
+	}
+
+	const SimdKernels genericKernels = {
+		SIMD_GENERIC,
+		complexMagnitudesGeneric,
+		complexDecibelsGeneric,
+		accumulateComplexPowersGeneric,
+		toDecibelsGeneric,
+		multiplyGeneric,
+		logQuantizeGeneric,
+		quantizeGeneric,
+		quantize16Generic
+	};
+
+#if SIMD_KERNELS_X86
+	// SSE2: 4 lanes.
+
+	SIMD_TARGET("sse2") inline __m128 log2Sse2(__m128i bits)
+	{
+		__m128i exponent = _mm_sub_epi32(
+			_mm_and_si128(_mm_srli_epi32(bits, 23), _mm_set1_epi32(0xff)), _mm_set1_epi32(127));
+		__m128i mantissaBits = _mm_or_si128(
+			_mm_and_si128(bits, _mm_set1_epi32(0x007fffff)), _mm_set1_epi32(0x3f800000));
+
+		// All ones where the mantissa is above sqrt(2).
+		__m128i isLarge = _mm_cmpgt_epi32(mantissaBits, _mm_set1_epi32(0x3fb504f3));
+		mantissaBits = _mm_sub_epi32(mantissaBits, _mm_and_si128(isLarge, _mm_set1_epi32(1 << 23)));
+		exponent = _mm_sub_epi32(exponent, isLarge);
+
+		__m128 one = _mm_set1_ps(1);
+		__m128 mantissa = _mm_castsi128_ps(mantissaBits);
+		__m128 t = _mm_div_ps(_mm_sub_ps(mantissa, one), _mm_add_ps(mantissa, one));
+		__m128 t2 = _mm_mul_ps(t, t);
+		__m128 series = _mm_add_ps(_mm_set1_ps(0.96179669f), _mm_mul_ps(t2, _mm_set1_ps(0.57707801f)));
+		series = _mm_add_ps(_mm_set1_ps(2.88539008f), _mm_mul_ps(t2, series));
+		return _mm_add_ps(_mm_cvtepi32_ps(exponent), _mm_mul_ps(t, series));
+	}
+
+	/** |z|^2 of the 4 complex values at z. */
+	SIMD_TARGET("sse2") inline __m128 complexPowersSse2(const float* z)
+	{
+		__m128 a = _mm_loadu_ps(z);
+		__m128 b = _mm_loadu_ps(z + 4);
+		__m128 re = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+		__m128 im = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+		return _mm_add_ps(_mm_mul_ps(re, re), _mm_mul_ps(im, im));
+	}
+
+	SIMD_TARGET("sse2") void complexMagnitudesSse2(const float* z, float* out, int n, float scale)
+	{
+		__m128 scales = _mm_set1_ps(scale);
+		int i = 0;
+
+		for (; i + 4 <= n; i += 4)
+		{
+			_mm_storeu_ps(out + i, _mm_mul_ps(scales, _mm_sqrt_ps(complexPowersSse2(z + 2 * i))));
+		}
+
+		complexMagnitudesGeneric(z + 2 * i, out + i, n - i, scale);
+	}
+
+	SIMD_TARGET("sse2") void complexDecibelsSse2(const float* z, float* out, int n, float scale)
+	{
+		__m128 scales = _mm_set1_ps(scale * scale);
+		__m128 decibelsPerLog2 = _mm_set1_ps(decibelsPerLog2OfPower);
+		int i = 0;
+
+		for (; i + 4 <= n; i += 4)
+		{
+			__m128 powers = _mm_mul_ps(scales, complexPowersSse2(z + 2 * i));
+			_mm_storeu_ps(out + i, _mm_mul_ps(decibelsPerLog2, log2Sse2(_mm_castps_si128(powers))));
+		}
+
+		complexDecibelsGeneric(z + 2 * i, out + i, n - i, scale);
+	}
+
+	SIMD_TARGET("sse2") void accumulateComplexPowersSse2(const float* z, float* out, int n)
+	{
+		int i = 0;
+
+		for (; i + 4 <= n; i += 4)
+		{
+			_mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), complexPowersSse2(z + 2 * i)));
+		}
+
+		accumulateComplexPowersGeneric(z + 2 * i, out + i, n - i);
+	}
+
+	SIMD_TARGET("sse2") void toDecibelsSse2(const float* in, float* out, int n, float scale, float decibelsPerDecade)
+	{
+		__m128 scales = _mm_set1_ps(scale);
+		__m128 decibelsPerLog2 = _mm_set1_ps(decibelsPerDecade * log10Of2);
+		int i = 0;
+
+		for (; i + 4 <= n; i += 4)
+		{
+			__m128 values = _mm_mul_ps(scales, _mm_loadu_ps(in + i));
+			__m128 decibels = _mm_mul_ps(decibelsPerLog2, log2Sse2(_mm_castps_si128(values)));
+
+			// Keep NaN (no data) as it is.
+			__m128 isNaN = _mm_cmpunord_ps(values, values);
+			_mm_storeu_ps(out + i, _mm_or_ps(_mm_and_ps(isNaN, values), _mm_andnot_ps(isNaN, decibels)));
+		}
+
+		toDecibelsGeneric(in + i, out + i, n - i, scale, decibelsPerDecade);
+	}
+
+	SIMD_TARGET("sse2") void multiplySse2(const float* in, const float* window, float* out, int n)
+	{
+		int i = 0;
+
+		for (; i + 4 <= n; i += 4)
+		{
+			_mm_storeu_ps(out + i, _mm_mul_ps(_mm_loadu_ps(in + i), _mm_loadu_ps(window + i)));
+		}
+
+		multiplyGeneric(in + i, window + i, out + i, n - i);
+	}
+
+	SIMD_TARGET("sse2") void logQuantizeSse2(const float* in, uint8_t* levels, int n, float gain, float offset, int maxLevel)
+	{
+		__m128 gains = _mm_set1_ps(gain);
+		__m128 offsets = _mm_set1_ps(offset);
+		__m128 lowest = _mm_setzero_ps();
+		__m128 highest = _mm_set1_ps(float(maxLevel));
+		int i = 0;
+
+		for (; i + 4 <= n; i += 4)
+		{
+			__m128i bits = _mm_castps_si128(_mm_loadu_ps(in + i));
+
+			// NaN (no data) becomes zero, so that it lands on level 0.
+			__m128i isNaN = _mm_cmpgt_epi32(_mm_and_si128(bits, _mm_set1_epi32(0x7fffffff)), _mm_set1_epi32(0x7f800000));
+			bits = _mm_andnot_si128(isNaN, bits);
+
+			// Clamping before truncation gives the same levels as after it.
+			__m128 level = _mm_add_ps(_mm_mul_ps(log2Sse2(bits), gains), offsets);
+			level = _mm_min_ps(_mm_max_ps(level, lowest), highest);
+
+			__m128i words = _mm_packs_epi32(_mm_cvttps_epi32(level), _mm_setzero_si128());
+			int32_t bytes = _mm_cvtsi128_si32(_mm_packus_epi16(words, words));
+			std::memcpy(levels + i, &bytes, sizeof(bytes));
+		}
+
+		logQuantizeGeneric(in + i, levels + i, n - i, gain, offset, maxLevel);
+	}
+
+	SIMD_TARGET("sse2") void quantizeSse2(const float* in, uint8_t* levels, int n, float gain, float offset, int maxLevel)
+	{
+		__m128 gains = _mm_set1_ps(gain);
+		__m128 offsets = _mm_set1_ps(offset);
+		__m128 lowest = _mm_setzero_ps();
+		__m128 highest = _mm_set1_ps(float(maxLevel));
+		int i = 0;
+
+		for (; i + 4 <= n; i += 4)
+		{
+			// max returns its second operand for NaN, so no data lands on level 0.
+			__m128 level = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(in + i), gains), offsets);
+			level = _mm_min_ps(_mm_max_ps(level, lowest), highest);
+
+			__m128i words = _mm_packs_epi32(_mm_cvttps_epi32(level), _mm_setzero_si128());
+			int32_t bytes = _mm_cvtsi128_si32(_mm_packus_epi16(words, words));
+			std::memcpy(levels + i, &bytes, sizeof(bytes));
+		}
+
+		quantizeGeneric(in + i, levels + i, n - i, gain, offset, maxLevel);
+	}
+
+	SIMD_TARGET("sse2") void quantize16Sse2(const float* in, uint16_t* levels, int n, float gain, float offset, int maxLevel)
+	{
+		__m128 gains = _mm_set1_ps(gain);
+		__m128 offsets = _mm_set1_ps(offset);
+		__m128 lowest = _mm_setzero_ps();
+		__m128 highest = _mm_set1_ps(float(maxLevel));
+		int i = 0;
+
+		for (; i + 4 <= n; i += 4)
+		{
+			__m128 level = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(in + i), gains), offsets);
+			level = _mm_min_ps(_mm_max_ps(level, lowest), highest);
+
+			// SSE2 only packs with signed saturation, so shift the range to
+			// int16 and back.
+			__m128i shifted = _mm_sub_epi32(_mm_cvttps_epi32(level), _mm_set1_epi32(0x8000));
+			__m128i words = _mm_xor_si128(_mm_packs_epi32(shifted, shifted), _mm_set1_epi16(-0x8000));
+			_mm_storel_epi64((__m128i*)(levels + i), words);
+		}
+
+		quantize16Generic(in + i, levels + i, n - i, gain, offset, maxLevel);
+	}
+
+	const SimdKernels sse2Kernels = {
+		SIMD_SSE2,
+		complexMagnitudesSse2,
+		complexDecibelsSse2,
+		accumulateComplexPowersSse2,
+		toDecibelsSse2,
+		multiplySse2,
+		logQuantizeSse2,
+		quantizeSse2,
+		quantize16Sse2
+	};
+
+	// AVX2: 8 lanes.
+
+	SIMD_TARGET("avx2") inline __m256 log2Avx2(__m256i bits)
+	{
+		__m256i exponent = _mm256_sub_epi32(
+			_mm256_and_si256(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(0xff)), _mm256_set1_epi32(127));
+		__m256i mantissaBits = _mm256_or_si256(
+			_mm256_and_si256(bits, _mm256_set1_epi32(0x007fffff)), _mm256_set1_epi32(0x3f800000));
+
+		__m256i isLarge = _mm256_cmpgt_epi32(mantissaBits, _mm256_set1_epi32(0x3fb504f3));
+		mantissaBits = _mm256_sub_epi32(mantissaBits, _mm256_and_si256(isLarge, _mm256_set1_epi32(1 << 23)));
+		exponent = _mm256_sub_epi32(exponent, isLarge);
+
+		__m256 one = _mm256_set1_ps(1);
+		__m256 mantissa = _mm256_castsi256_ps(mantissaBits);
+		__m256 t = _mm256_div_ps(_mm256_sub_ps(mantissa, one), _mm256_add_ps(mantissa, one));
+		__m256 t2 = _mm256_mul_ps(t, t);
+		__m256 series = _mm256_add_ps(_mm256_set1_ps(0.96179669f), _mm256_mul_ps(t2, _mm256_set1_ps(0.57707801f)));
+		series = _mm256_add_ps(_mm256_set1_ps(2.88539008f), _mm256_mul_ps(t2, series));
+		return _mm256_add_ps(_mm256_cvtepi32_ps(exponent), _mm256_mul_ps(t, series));
+	}
+
+	/** |z|^2 of the 8 complex values at z. */
+	SIMD_TARGET("avx2") inline __m256 complexPowersAvx2(const float* z)
+	{
+		__m256 a = _mm256_loadu_ps(z);
+		__m256 b = _mm256_loadu_ps(z + 8);
+
+		// Shuffles stay within 128-bit halves, so this yields bins 0 1 4 5 2 3 6 7...
+		__m256 re = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+		__m256 im = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+		__m256 powers = _mm256_add_ps(_mm256_mul_ps(re, re), _mm256_mul_ps(im, im));
+
+		// ...and swapping the middle pairs puts them back in order.
+		return _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(powers), _MM_SHUFFLE(3, 1, 2, 0)));
+	}
+
+	SIMD_TARGET("avx2") void complexMagnitudesAvx2(const float* z, float* out, int n, float scale)
+	{
+		__m256 scales = _mm256_set1_ps(scale);
+		int i = 0;
+
+		for (; i + 8 <= n; i += 8)
+		{
+			_mm256_storeu_ps(out + i, _mm256_mul_ps(scales, _mm256_sqrt_ps(complexPowersAvx2(z + 2 * i))));
+		}
+
+		complexMagnitudesSse2(z + 2 * i, out + i, n - i, scale);
+	}
+
+	SIMD_TARGET("avx2") void complexDecibelsAvx2(const float* z, float* out, int n, float scale)
+	{
+		__m256 scales = _mm256_set1_ps(scale * scale);
+		__m256 decibelsPerLog2 = _mm256_set1_ps(decibelsPerLog2OfPower);
+		int i = 0;
+
+		for (; i + 8 <= n; i += 8)
+		{
+			__m256 powers = _mm256_mul_ps(scales, complexPowersAvx2(z + 2 * i));
+			_mm256_storeu_ps(out + i, _mm256_mul_ps(decibelsPerLog2, log2Avx2(_mm256_castps_si256(powers))));
+		}
+
+		complexDecibelsSse2(z + 2 * i, out + i, n - i, scale);
+	}
+
+	SIMD_TARGET("avx2") void accumulateComplexPowersAvx2(const float* z, float* out, int n)
+	{
+		int i = 0;
+
+		for (; i + 8 <= n; i += 8)
+		{
+			_mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_loadu_ps(out + i), complexPowersAvx2(z + 2 * i)));
+		}
+
+		accumulateComplexPowersSse2(z + 2 * i, out + i, n - i);
+	}
+
+	SIMD_TARGET("avx2") void toDecibelsAvx2(const float* in, float* out, int n, float scale, float decibelsPerDecade)
+	{
+		__m256 scales = _mm256_set1_ps(scale);
+		__m256 decibelsPerLog2 = _mm256_set1_ps(decibelsPerDecade * log10Of2);
+		int i = 0;
+
+		for (; i + 8 <= n; i += 8)
+		{
+			__m256 values = _mm256_mul_ps(scales, _mm256_loadu_ps(in + i));
+			__m256 decibels = _mm256_mul_ps(decibelsPerLog2, log2Avx2(_mm256_castps_si256(values)));
+			__m256 isNaN = _mm256_cmp_ps(values, values, _CMP_UNORD_Q);
+			_mm256_storeu_ps(out + i, _mm256_blendv_ps(decibels, values, isNaN));
+		}
+
+		toDecibelsSse2(in + i, out + i, n - i, scale, decibelsPerDecade);
+	}
+
+	SIMD_TARGET("avx2") void multiplyAvx2(const float* in, const float* window, float* out, int n)
+	{
+		int i = 0;
+
+		for (; i + 8 <= n; i += 8)
+		{
+			_mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_loadu_ps(in + i), _mm256_loadu_ps(window + i)));
+		}
+
+		multiplySse2(in + i, window + i, out + i, n - i);
+	}
+
+	SIMD_TARGET("avx2") void logQuantizeAvx2(const float* in, uint8_t* levels, int n, float gain, float offset, int maxLevel)
+	{
+		__m256 gains = _mm256_set1_ps(gain);
+		__m256 offsets = _mm256_set1_ps(offset);
+		__m256 lowest = _mm256_setzero_ps();
+		__m256 highest = _mm256_set1_ps(float(maxLevel));
+		int i = 0;
+
+		for (; i + 8 <= n; i += 8)
+		{
+			__m256i bits = _mm256_castps_si256(_mm256_loadu_ps(in + i));
+			__m256i isNaN = _mm256_cmpgt_epi32(
+				_mm256_and_si256(bits, _mm256_set1_epi32(0x7fffffff)), _mm256_set1_epi32(0x7f800000));
+			bits = _mm256_andnot_si256(isNaN, bits);
+
+			__m256 level = _mm256_add_ps(_mm256_mul_ps(log2Avx2(bits), gains), offsets);
+			level = _mm256_min_ps(_mm256_max_ps(level, lowest), highest);
+
+			__m256i integers = _mm256_cvttps_epi32(level);
+			__m128i words = _mm_packs_epi32(_mm256_castsi256_si128(integers), _mm256_extracti128_si256(integers, 1));
+			_mm_storel_epi64((__m128i*)(levels + i), _mm_packus_epi16(words, words));
+		}
+
+		logQuantizeSse2(in + i, levels + i, n - i, gain, offset, maxLevel);
+	}
+
+	SIMD_TARGET("avx2") void quantizeAvx2(const float* in, uint8_t* levels, int n, float gain, float offset, int maxLevel)
+	{
+		__m256 gains = _mm256_set1_ps(gain);
+		__m256 offsets = _mm256_set1_ps(offset);
+		__m256 lowest = _mm256_setzero_ps();
+		__m256 highest = _mm256_set1_ps(float(maxLevel));
+		int i = 0;
+
+		for (; i + 8 <= n; i += 8)
+		{
+			__m256 level = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(in + i), gains), offsets);
+			level = _mm256_min_ps(_mm256_max_ps(level, lowest), highest);
+
+			__m256i integers = _mm256_cvttps_epi32(level);
+			__m128i words = _mm_packs_epi32(_mm256_castsi256_si128(integers), _mm256_extracti128_si256(integers, 1));
+			_mm_storel_epi64((__m128i*)(levels + i), _mm_packus_epi16(words, words));
+		}
+
+		quantizeSse2(in + i, levels + i, n - i, gain, offset, maxLevel);
+	}
+
+	SIMD_TARGET("avx2") void quantize16Avx2(const float* in, uint16_t* levels, int n, float gain, float offset, int maxLevel)
+	{
+		__m256 gains = _mm256_set1_ps(gain);
+		__m256 offsets = _mm256_set1_ps(offset);
+		__m256 lowest = _mm256_setzero_ps();
+		__m256 highest = _mm256_set1_ps(float(maxLevel));
+		int i = 0;
+
+		for (; i + 8 <= n; i += 8)
+		{
+			__m256 level = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(in + i), gains), offsets);
+			level = _mm256_min_ps(_mm256_max_ps(level, lowest), highest);
+
+			__m256i integers = _mm256_cvttps_epi32(level);
+			__m128i words = _mm_packus_epi32(_mm256_castsi256_si128(integers), _mm256_extracti128_si256(integers, 1));
+			_mm_storeu_si128((__m128i*)(levels + i), words);
+		}
+
+		quantize16Sse2(in + i, levels + i, n - i, gain, offset, maxLevel);
+	}
+
+	const SimdKernels avx2Kernels = {
+		SIMD_AVX2,
+		complexMagnitudesAvx2,
+		complexDecibelsAvx2,
+		accumulateComplexPowersAvx2,
+		toDecibelsAvx2,
+		multiplyAvx2,
+		logQuantizeAvx2,
+		quantizeAvx2,
+		quantize16Avx2
+	};
+
+	// AVX-512 (foundation instructions only): 16 lanes.
+
+	// GCC 12's own AVX-512 headers trip -Wmaybe-uninitialized on their
+	// placeholder operands.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+	SIMD_TARGET("avx512f") inline __m512 log2Avx512(__m512i bits)
+	{
+		__m512i exponent = _mm512_sub_epi32(
+			_mm512_and_si512(_mm512_srli_epi32(bits, 23), _mm512_set1_epi32(0xff)), _mm512_set1_epi32(127));
+		__m512i mantissaBits = _mm512_or_si512(
+			_mm512_and_si512(bits, _mm512_set1_epi32(0x007fffff)), _mm512_set1_epi32(0x3f800000));
+
+		__mmask16 isLarge = _mm512_cmpgt_epi32_mask(mantissaBits, _mm512_set1_epi32(0x3fb504f3));
+		mantissaBits = _mm512_mask_sub_epi32(mantissaBits, isLarge, mantissaBits, _mm512_set1_epi32(1 << 23));
+		exponent = _mm512_mask_add_epi32(exponent, isLarge, exponent, _mm512_set1_epi32(1));
+
+		__m512 one = _mm512_set1_ps(1);
+		__m512 mantissa = _mm512_castsi512_ps(mantissaBits);
+		__m512 t = _mm512_div_ps(_mm512_sub_ps(mantissa, one), _mm512_add_ps(mantissa, one));
+		__m512 t2 = _mm512_mul_ps(t, t);
+		__m512 series = _mm512_fmadd_ps(t2, _mm512_set1_ps(0.57707801f), _mm512_set1_ps(0.96179669f));
+		series = _mm512_fmadd_ps(t2, series, _mm512_set1_ps(2.88539008f));
+		return _mm512_fmadd_ps(t, series, _mm512_cvtepi32_ps(exponent));
+	}
+
+	/** |z|^2 of the 16 complex values at z. */
+	SIMD_TARGET("avx512f") inline __m512 complexPowersAvx512(const float* z)
+	{
+		const __m512i evenIndices = _mm512_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30);
+		const __m512i oddIndices = _mm512_setr_epi32(1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21, 23, 25, 27, 29, 31);
+
+		__m512 a = _mm512_loadu_ps(z);
+		__m512 b = _mm512_loadu_ps(z + 16);
+		__m512 re = _mm512_permutex2var_ps(a, evenIndices, b);
+		__m512 im = _mm512_permutex2var_ps(a, oddIndices, b);
+		return _mm512_fmadd_ps(re, re, _mm512_mul_ps(im, im));
+	}
+
+	SIMD_TARGET("avx512f") void complexMagnitudesAvx512(const float* z, float* out, int n, float scale)
+	{
+		__m512 scales = _mm512_set1_ps(scale);
+		int i = 0;
+
+		for (; i + 16 <= n; i += 16)
+		{
+			_mm512_storeu_ps(out + i, _mm512_mul_ps(scales, _mm512_sqrt_ps(complexPowersAvx512(z + 2 * i))));
+		}
+
+		complexMagnitudesSse2(z + 2 * i, out + i, n - i, scale);
+	}
+
+	SIMD_TARGET("avx512f") void complexDecibelsAvx512(const float* z, float* out, int n, float scale)
+	{
+		__m512 scales = _mm512_set1_ps(scale * scale);
+		__m512 decibelsPerLog2 = _mm512_set1_ps(decibelsPerLog2OfPower);
+		int i = 0;
+
+		for (; i + 16 <= n; i += 16)
+		{
+			__m512 powers = _mm512_mul_ps(scales, complexPowersAvx512(z + 2 * i));
+			_mm512_storeu_ps(out + i, _mm512_mul_ps(decibelsPerLog2, log2Avx512(_mm512_castps_si512(powers))));
+		}
+
+		complexDecibelsSse2(z + 2 * i, out + i, n - i, scale);
+	}
+
+	SIMD_TARGET("avx512f") void accumulateComplexPowersAvx512(const float* z, float* out, int n)
+	{
+		int i = 0;
+
+		for (; i + 16 <= n; i += 16)
+		{
+			_mm512_storeu_ps(out + i, _mm512_add_ps(_mm512_loadu_ps(out + i), complexPowersAvx512(z + 2 * i)));
+		}
+
+		accumulateComplexPowersSse2(z + 2 * i, out + i, n - i);
+	}
+
+	SIMD_TARGET("avx512f") void toDecibelsAvx512(const float* in, float* out, int n, float scale, float decibelsPerDecade)
+	{
+		__m512 scales = _mm512_set1_ps(scale);
+		__m512 decibelsPerLog2 = _mm512_set1_ps(decibelsPerDecade * log10Of2);
+		int i = 0;
+
+		for (; i + 16 <= n; i += 16)
+		{
+			__m512 values = _mm512_mul_ps(scales, _mm512_loadu_ps(in + i));
+			__m512 decibels = _mm512_mul_ps(decibelsPerLog2, log2Avx512(_mm512_castps_si512(values)));
+			__mmask16 isNaN = _mm512_cmp_ps_mask(values, values, _CMP_UNORD_Q);
+			_mm512_storeu_ps(out + i, _mm512_mask_mov_ps(decibels, isNaN, values));
+		}
+
+		toDecibelsSse2(in + i, out + i, n - i, scale, decibelsPerDecade);
+	}
+
+	SIMD_TARGET("avx512f") void multiplyAvx512(const float* in, const float* window, float* out, int n)
+	{
+		int i = 0;
+
+		for (; i + 16 <= n; i += 16)
+		{
+			_mm512_storeu_ps(out + i, _mm512_mul_ps(_mm512_loadu_ps(in + i), _mm512_loadu_ps(window + i)));
+		}
+
+		multiplySse2(in + i, window + i, out + i, n - i);
+	}
+
+	SIMD_TARGET("avx512f") void logQuantizeAvx512(const float* in, uint8_t* levels, int n, float gain, float offset, int maxLevel)
+	{
+		__m512 gains = _mm512_set1_ps(gain);
+		__m512 offsets = _mm512_set1_ps(offset);
+		__m512 lowest = _mm512_setzero_ps();
+		__m512 highest = _mm512_set1_ps(float(maxLevel));
+		int i = 0;
+
+		for (; i + 16 <= n; i += 16)
+		{
+			__m512i bits = _mm512_castps_si512(_mm512_loadu_ps(in + i));
+			__mmask16 isNaN = _mm512_cmpgt_epi32_mask(
+				_mm512_and_si512(bits, _mm512_set1_epi32(0x7fffffff)), _mm512_set1_epi32(0x7f800000));
+			bits = _mm512_maskz_mov_epi32(_mm512_knot(isNaN), bits);
+
+			__m512 level = _mm512_fmadd_ps(log2Avx512(bits), gains, offsets);
+			level = _mm512_min_ps(_mm512_max_ps(level, lowest), highest);
+			_mm_storeu_si128((__m128i*)(levels + i), _mm512_cvtepi32_epi8(_mm512_cvttps_epi32(level)));
+		}
+
+		logQuantizeSse2(in + i, levels + i, n - i, gain, offset, maxLevel);
+	}
+
+	SIMD_TARGET("avx512f") void quantizeAvx512(const float* in, uint8_t* levels, int n, float gain, float offset, int maxLevel)
+	{
+		__m512 gains = _mm512_set1_ps(gain);
+		__m512 offsets = _mm512_set1_ps(offset);
+		__m512 lowest = _mm512_setzero_ps();
+		__m512 highest = _mm512_set1_ps(float(maxLevel));
+		int i = 0;
+
+		for (; i + 16 <= n; i += 16)
+		{
+			__m512 level = _mm512_fmadd_ps(_mm512_loadu_ps(in + i), gains, offsets);
+			level = _mm512_min_ps(_mm512_max_ps(level, lowest), highest);
+			_mm_storeu_si128((__m128i*)(levels + i), _mm512_cvtepi32_epi8(_mm512_cvttps_epi32(level)));
+		}
+
+		quantizeSse2(in + i, levels + i, n - i, gain, offset, maxLevel);
+	}
+
+	SIMD_TARGET("avx512f") void quantize16Avx512(const float* in, uint16_t* levels, int n, float gain, float offset, int maxLevel)
+	{
+		__m512 gains = _mm512_set1_ps(gain);
+		__m512 offsets = _mm512_set1_ps(offset);
+		__m512 lowest = _mm512_setzero_ps();
+		__m512 highest = _mm512_set1_ps(float(maxLevel));
+		int i = 0;
+
+		for (; i + 16 <= n; i += 16)
+		{
+			__m512 level = _mm512_fmadd_ps(_mm512_loadu_ps(in + i), gains, offsets);
+			level = _mm512_min_ps(_mm512_max_ps(level, lowest), highest);
+			_mm256_storeu_si256((__m256i*)(levels + i), _mm512_cvtepi32_epi16(_mm512_cvttps_epi32(level)));
+		}
+
+		quantize16Sse2(in + i, levels + i, n - i, gain, offset, maxLevel);
+	}
+
+	const SimdKernels avx512Kernels = {
+		SIMD_AVX512,
+		complexMagnitudesAvx512,
+		complexDecibelsAvx512,
+		accumulateComplexPowersAvx512,
+		toDecibelsAvx512,
+		multiplyAvx512,
+		logQuantizeAvx512,
+		quantizeAvx512,
+		quantize16Avx512
+	};
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#endif
+
+	SimdLevel detectSimdLevel()
+	{
+#if SIMD_KERNELS_X86 && defined(_MSC_VER) && !defined(__clang__)
+		int info[4];
+		__cpuid(info, 0);
+		int maxLeaf = info[0];
+
+		__cpuid(info, 1);
+		bool hasSse2 = (info[3] & (1 << 26)) != 0;
+		bool hasXsave = (info[2] & (1 << 27)) != 0;
+		bool hasAvx2 = false;
+		bool hasAvx512 = false;
+
+		if (maxLeaf >= 7)
+		{
+			__cpuidex(info, 7, 0);
+			hasAvx2 = (info[1] & (1 << 5)) != 0;
+			hasAvx512 = (info[1] & (1 << 16)) != 0;
+		}
+
+		// The OS must also save the wider registers on context switches.
+		unsigned long long enabledStates = hasXsave ? _xgetbv(0) : 0;
+		hasAvx2 = hasAvx2 && (enabledStates & 0x06) == 0x06;
+		hasAvx512 = hasAvx512 && (enabledStates & 0xe6) == 0xe6;
+
+		if (hasAvx512)
+		{
+			return SIMD_AVX512;
+		}
+
+		if (hasAvx2)
+		{
+			return SIMD_AVX2;
+		}
+
+		if (hasSse2)
+		{
+			return SIMD_SSE2;
+		}
+#elif SIMD_KERNELS_X86
+		// These also check that the OS has enabled the wider registers.
+		__builtin_cpu_init();
+
+		if (__builtin_cpu_supports("avx512f"))
+		{
+			return SIMD_AVX512;
+		}
+
+		if (__builtin_cpu_supports("avx2"))
+		{
+			return SIMD_AVX2;
+		}
+
+		if (__builtin_cpu_supports("sse2"))
+		{
+			return SIMD_SSE2;
+		}
+#endif
+
+		return SIMD_GENERIC;
+	}
+}
+
+SimdLevel SpectrogramViewer::getSupportedSimdLevel()
+{
+	static const SimdLevel level = detectSimdLevel();
+	return level;
+}
+
+const SimdKernels& SpectrogramViewer::getSimdKernels()
+{
+	return getSimdKernels(SIMD_AVX512);
+}
+
+const SimdKernels& SpectrogramViewer::getSimdKernels(SimdLevel maxLevel)
+{
+	SimdLevel level = getSupportedSimdLevel() < maxLevel ? getSupportedSimdLevel() : maxLevel;
+
+#if SIMD_KERNELS_X86
+	switch (level)
+	{
+	case SIMD_AVX512:
+		return avx512Kernels;
+	case SIMD_AVX2:
+		return avx2Kernels;
+	case SIMD_SSE2:
+		return sse2Kernels;
+	default:
+		break;
+	}
+#endif
+
+	return genericKernels;
+}
+
+const char* SpectrogramViewer::getSimdLevelName(SimdLevel level)
+{
+	switch (level)
+	{
+	case SIMD_SSE2:
+		return "SSE2";
+	case SIMD_AVX2:
+		return "AVX2";
+	case SIMD_AVX512:
+		return "AVX-512";
+	default:
+		return "generic";
+	}
+}
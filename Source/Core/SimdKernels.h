@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+
+namespace SpectrogramViewer
+{
+	/** Instruction sets that the kernels in SimdKernels are compiled for. */
+	enum SimdLevel
+	{
+		SIMD_GENERIC = 0,
+		SIMD_SSE2,
+		SIMD_AVX2,
+		SIMD_AVX512
+	};
+
+	/** The per-bin inner loops of the spectrogram, compiled once per instruction
+	set and picked at runtime from the features of the CPU.
+
+	Every kernel works on unaligned arrays of any length; the SIMD variants
+	hand the last few elements to the generic one. Complex inputs are
+	interleaved (re, im, re, im, ...), which is how both pocketfft's complex
+	type and the FFTPACK half-complex layout store them.
+
+	Logs use the same branch-free approximation everywhere: log2 is accurate
+	to about 2e-6, i.e. 1e-5 dB. Zero gives a log2 of about -127.
+
+	The variants live in one file and need no special compiler flags: GCC and
+	Clang build each with a per-function target attribute, and MSVC accepts
+	the intrinsics as they are. Non-x86 builds only have the generic kernels,
+	which are written so that the compiler can vectorize them where it can.
+	*/
+	struct SimdKernels
+	{
+		SimdLevel level;
+
+		/** out[i] = scale * |z[i]|. */
+		void (*complexMagnitudes)(const float* z, float* out, int n, float scale);
+
+		/** out[i] = 20 log10(scale * |z[i]|). */
+		void (*complexDecibels)(const float* z, float* out, int n, float scale);
+
+		/** out[i] += |z[i]|^2. */
+		void (*accumulateComplexPowers)(const float* z, float* out, int n);
+
+		/** out[i] = decibelsPerDecade * log10(scale * in[i]); use 20 for
+		magnitudes and 10 for powers. NaN stays NaN. in and out may be the
+		same array. */
+		void (*toDecibels)(const float* in, float* out, int n, float scale, float decibelsPerDecade);
+
+		/** out[i] = in[i] * window[i]. */
+		void (*multiply)(const float* in, const float* window, float* out, int n);
+
+		/** levels[i] = int(log2(in[i]) * gain + offset), clamped to
+		[0, maxLevel], with NaN taken as 0. Used by the colour map. */
+		void (*logQuantize)(const float* in, uint8_t* levels, int n, float gain, float offset, int maxLevel);
+
+		/** levels[i] = int(in[i] * gain + offset), clamped to [0, maxLevel],
+		with NaN taken as 0. Used by the colour map for values in dB. */
+		void (*quantize)(const float* in, uint8_t* levels, int n, float gain, float offset, int maxLevel);
+
+		/** As quantize(), into 16-bit levels; maxLevel must not exceed 65535. */
+		void (*quantize16)(const float* in, uint16_t* levels, int n, float gain, float offset, int maxLevel);
+	};
+
+	/** Returns the best instruction set that both the CPU and this build support. */
+	SimdLevel getSupportedSimdLevel();
+
+	/** Returns the kernels for the best supported instruction set. Detection
+	runs once, on the first call. */
+	const SimdKernels& getSimdKernels();
+
+	/** Returns the kernels for the given instruction set, or for the best
+	supported one below it. Meant for benchmarks and comparisons. */
+	const SimdKernels& getSimdKernels(SimdLevel maxLevel);
+
+	const char* getSimdLevelName(SimdLevel level);
+}
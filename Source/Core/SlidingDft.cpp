@@ -0,0 +1,276 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "SlidingDft.h"
+#include "SimdKernels.h"
+
+using namespace SpectrogramViewer;
+
+namespace
+{
+	const double pi = 3.14159265358979323846;
+
+	/** Applies a window of numTerms cosine terms to the sums of one channel:
+	spectrum[k] = sum over p of coefficients[p] * sums[k + p], for p from
+	-numTerms to numTerms, where coefficients[0] is real. With numTerms fixed,
+	the terms unroll and the loop over the bins vectorizes. */
+	template <int numTerms>
+	void combineTerms(
+		const double* sumReal,
+		const double* sumImag,
+		const double* coefficientsReal,
+		const double* coefficientsImag,
+		float* spectrum,
+		int numBins)
+	{
+		for (int k = 0; k < numBins; k++)
+		{
+			double real = coefficientsReal[0] * sumReal[k];
+			double imag = coefficientsReal[0] * sumImag[k];
+
+			for (int p = 1; p <= numTerms; p++)
+			{
+				real += coefficientsReal[-p] * sumReal[k - p] - coefficientsImag[-p] * sumImag[k - p];
+				imag += coefficientsReal[-p] * sumImag[k - p] + coefficientsImag[-p] * sumReal[k - p];
+				real += coefficientsReal[p] * sumReal[k + p] - coefficientsImag[p] * sumImag[k + p];
+				imag += coefficientsReal[p] * sumImag[k + p] + coefficientsImag[p] * sumReal[k + p];
+			}
+
+			spectrum[2 * k] = float(real);
+			spectrum[2 * k + 1] = float(imag);
+		}
+	}
+}
+
+double SlidingDft::estimateCost(int hopLength, int numBins)
+{
+	// The sums take a few bins beyond the output to apply the window.
+	return COST_PER_BIN_SAMPLE * hopLength * (numBins + MAX_TERMS) + COST_PER_BIN_FRAME * numBins;
+}
+
+bool SlidingDft::supportsWindow(WindowFunction function)
+{
+	double coefficients[4];
+	return getCosineSumCoefficients(function, coefficients);
+}
+
+void SlidingDft::prepare(int numChannels_, int length_, int hopLength_, int numBins_, WindowFunction window)
+{
+	numChannels = numChannels_;
+	length = std::max(1, length_);
+	hopLength = std::max(1, std::min(hopLength_, length));
+	numBins = std::max(1, numBins_);
+
+	// A cosine sum multiplies the frame by a0 - a1/2 (W^-n + W^n) + ..., so
+	// output bin k is a0 X[k] - a1/2 (X[k - 1] + X[k + 1]) + ...
+	double a[4];
+	getCosineSumCoefficients(window, a);
+	numTerms = 0;
+
+	for (int p = 1; p <= MAX_TERMS; p++)
+	{
+		if (a[p] != 0)
+		{
+			numTerms = p;
+		}
+	}
+
+	std::fill(std::begin(termCoefficients), std::end(termCoefficients), 0.0);
+	termCoefficients[MAX_TERMS] = a[0];
+
+	for (int p = 1; p <= numTerms; p++)
+	{
+		double coefficient = ((p % 2) ? -a[p] : a[p]) / 2;
+		termCoefficients[MAX_TERMS - p] = coefficient;
+		termCoefficients[MAX_TERMS + p] = coefficient;
+	}
+
+	// Only the bins up to Nyquist are summed; the output needs numTerms more
+	// than it shows, unless that reaches Nyquist.
+	int nyquistBin = length / 2;
+	numSumBins = std::min(numBins + numTerms, nyquistBin + 1);
+	sumStride = numSumBins + 2 * MAX_TERMS;
+
+	// The bins just below 0, and beyond Nyquist if the sums reach it, are
+	// conjugates of bins within it.
+	for (int q = 0; q < 2 * MAX_TERMS; q++)
+	{
+		int bin = (q < MAX_TERMS) ? q - MAX_TERMS : numSumBins + q - MAX_TERMS;
+		bin = (bin % length + length) % length;
+		bool conjugate = bin > nyquistBin;
+		padSources[q] = conjugate ? length - bin : bin;
+		padImagSigns[q] = conjugate ? -1 : 1;
+
+		if (padSources[q] >= numSumBins)
+		{
+			padSources[q] = -1;
+		}
+	}
+
+	twiddleReal.resize(length);
+	twiddleImag.resize(length);
+
+	for (int n = 0; n < length; n++)
+	{
+		twiddleReal[n] = std::cos(2 * pi * n / length);
+		twiddleImag[n] = -std::sin(2 * pi * n / length);
+	}
+
+	sumsReal.resize(numChannels * sumStride);
+	sumsImag.resize(sumsReal.size());
+	delayLines.resize(numChannels * length);
+	rotationsReal.resize(hopLength * numSumBins);
+	rotationsImag.resize(rotationsReal.size());
+	deltas.resize(hopLength);
+	spectrum.resize(2 * numBins);
+	reset();
+}
+
+void SlidingDft::reset()
+{
+	std::fill(sumsReal.begin(), sumsReal.end(), 0.0);
+	std::fill(sumsImag.begin(), sumsImag.end(), 0.0);
+	std::fill(delayLines.begin(), delayLines.end(), 0.f);
+	position = 0;
+}
+
+void SlidingDft::calcMagnitudes(const float* const* frames, float* const* out, int numFrames, float scalingFactor)
+{
+	int numOutputBins = std::min(numBins, length / 2 + 1);
+
+	for (int f = 0; f < numFrames; f++)
+	{
+		// The twiddles of the hop's samples are shared by every channel. Each
+		// row starts from the table and is rotated by W^k, so they are only a
+		// hop's worth of roundings off.
+		for (int k = 0, index = 0; k < numSumBins; k++)
+		{
+			rotationsReal[k] = twiddleReal[index];
+			rotationsImag[k] = twiddleImag[index];
+
+			// index = k * position modulo length.
+			index += position;
+
+			if (index >= length)
+			{
+				index -= length;
+			}
+		}
+
+		for (int j = 1; j < hopLength; j++)
+		{
+			auto previousReal = &rotationsReal[(j - 1) * numSumBins];
+			auto previousImag = &rotationsImag[(j - 1) * numSumBins];
+			auto rowReal = &rotationsReal[j * numSumBins];
+			auto rowImag = &rotationsImag[j * numSumBins];
+
+			for (int k = 0; k < numSumBins; k++)
+			{
+				rowReal[k] = previousReal[k] * twiddleReal[k] - previousImag[k] * twiddleImag[k];
+				rowImag[k] = previousReal[k] * twiddleImag[k] + previousImag[k] * twiddleReal[k];
+			}
+		}
+
+		// After the hop the frame starts at the new position, so its DFT is
+		// W^(-k position) times the sums. That factor drops out of the
+		// magnitude, which leaves W^(-p position) on bin k + p.
+		int start = position;
+		position = (position + hopLength) % length;
+		double coefficientsReal[2 * MAX_TERMS + 1];
+		double coefficientsImag[2 * MAX_TERMS + 1];
+
+		for (int p = -numTerms; p <= numTerms; p++)
+		{
+			int index = int((int64_t(length - p) * position) % length);
+			coefficientsReal[MAX_TERMS + p] = termCoefficients[MAX_TERMS + p] * twiddleReal[index];
+			coefficientsImag[MAX_TERMS + p] = termCoefficients[MAX_TERMS + p] * twiddleImag[index];
+		}
+
+		// Each channel's sums stay in cache from the first sample of the hop
+		// to the readout.
+		for (int c = 0; c < numChannels; c++)
+		{
+			auto newSamples = frames[f * numChannels + c] + length - hopLength;
+			auto delayLine = &delayLines[c * length];
+			auto sumReal = &sumsReal[c * sumStride + MAX_TERMS];
+			auto sumImag = &sumsImag[c * sumStride + MAX_TERMS];
+			int n = start;
+
+			for (int j = 0; j < hopLength; j++)
+			{
+				deltas[j] = double(newSamples[j]) - delayLine[n];
+				delayLine[n] = newSamples[j];
+
+				if (++n == length)
+				{
+					n = 0;
+				}
+			}
+
+			// Two samples per pass halve the loads and stores of the sums,
+			// which bound the loop.
+			int j = 0;
+
+			for (; j + 1 < hopLength; j += 2)
+			{
+				double delta0 = deltas[j];
+				double delta1 = deltas[j + 1];
+				auto rowReal0 = &rotationsReal[j * numSumBins];
+				auto rowImag0 = &rotationsImag[j * numSumBins];
+				auto rowReal1 = rowReal0 + numSumBins;
+				auto rowImag1 = rowImag0 + numSumBins;
+
+				for (int k = 0; k < numSumBins; k++)
+				{
+					sumReal[k] += delta0 * rowReal0[k] + delta1 * rowReal1[k];
+					sumImag[k] += delta0 * rowImag0[k] + delta1 * rowImag1[k];
+				}
+			}
+
+			if (j < hopLength)
+			{
+				double delta = deltas[j];
+				auto rowReal = &rotationsReal[j * numSumBins];
+				auto rowImag = &rotationsImag[j * numSumBins];
+
+				for (int k = 0; k < numSumBins; k++)
+				{
+					sumReal[k] += delta * rowReal[k];
+					sumImag[k] += delta * rowImag[k];
+				}
+			}
+
+			for (int q = 0; q < 2 * MAX_TERMS; q++)
+			{
+				int bin = (q < MAX_TERMS) ? q - MAX_TERMS : numSumBins + q - MAX_TERMS;
+				int source = padSources[q];
+				sumReal[bin] = (source >= 0) ? sumReal[source] : 0;
+				sumImag[bin] = (source >= 0) ? sumImag[source] * padImagSigns[q] : 0;
+			}
+
+			auto real = coefficientsReal + MAX_TERMS;
+			auto imag = coefficientsImag + MAX_TERMS;
+
+			switch (numTerms)
+			{
+			case 0:
+				combineTerms<0>(sumReal, sumImag, real, imag, spectrum.data(), numOutputBins);
+				break;
+			case 1:
+				combineTerms<1>(sumReal, sumImag, real, imag, spectrum.data(), numOutputBins);
+				break;
+			case 2:
+				combineTerms<2>(sumReal, sumImag, real, imag, spectrum.data(), numOutputBins);
+				break;
+			default:
+				combineTerms<3>(sumReal, sumImag, real, imag, spectrum.data(), numOutputBins);
+				break;
+			}
+
+			auto column = out[f * numChannels + c];
+			getSimdKernels().complexMagnitudes(spectrum.data(), column, numOutputBins, scalingFactor);
+			std::fill(column + numOutputBins, column + numBins, 0.f);
+		}
+	}
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <vector>
+
+#include "WindowFunctions.h"
+
+namespace SpectrogramViewer
+{
+	/** Windowed DFT magnitudes of real signals, updated sample by sample.
+
+	For every channel and bin k it keeps the sum of x[n] W^(k n) over the last
+	length samples, with W = exp(-2 pi i / length) and n counted from the last
+	reset(). A new sample adds (x[n] - x[n - length]) W^(k n), so a hop of h
+	samples costs O(h * numBins), where an FFT of every frame costs
+	O(length log length) whatever the hop. For short hops over long windows the
+	sliding DFT is the cheaper of the two; compare estimateCost() with
+	RealFft::estimateCost().
+
+	The window is applied in the frequency domain, which only works for the
+	cosine-sum windows (see getCosineSumCoefficients()): each output bin
+	combines up to three neighbours on either side. The sums are kept in
+	doubles. Each sample is added and later removed with twiddles that agree
+	to within rounding, so the errors only add up as a random walk: about
+	1e-12 of the signal after a day at 1 kHz.
+
+	All allocation happens in prepare(); calcMagnitudes() is safe to call from
+	the worker thread.
+	*/
+	class SlidingDft
+	{
+	public:
+		/** Cost model: COST_PER_BIN_SAMPLE nanoseconds per bin per new sample,
+		plus COST_PER_BIN_FRAME per output bin to apply the window. Measured with
+		64 channels next to RealFft (see Benchmarks/SlidingDftBenchmark.cpp),
+		and scaled by how far RealFft::estimateCost() was off on the same
+		machine, so that the two models can be compared. */
+		static constexpr double COST_PER_BIN_SAMPLE = 1.3;
+		static constexpr double COST_PER_BIN_FRAME = 7;
+
+		/** Returns the expected time of one frame of one channel, in nanoseconds. */
+		static double estimateCost(int hopLength, int numBins);
+
+		/** Returns true if the window can be applied in the frequency domain. */
+		static bool supportsWindow(WindowFunction function);
+
+		/** Allocates the state for numChannels channels and clears it.
+
+		Frames are length samples long and hopLength samples apart, with
+		0 < hopLength <= length. The first numBins bins of each are computed,
+		under the given window, which must pass supportsWindow().
+		*/
+		void prepare(int numChannels, int length, int hopLength, int numBins, WindowFunction window);
+
+		int getLength() const { return length; }
+		int getHopLength() const { return hopLength; }
+		int getNumBins() const { return numBins; }
+
+		/** Zeroes the sums and the delay lines, as if the channels had been
+		silent for a whole window, e.g. after input was dropped. */
+		void reset();
+
+		/** Takes in the frames that follow on from the last one and computes
+		the magnitudes of their first getNumBins() bins, multiplied by
+		scalingFactor, as RealFft::calcMagnitudes() would. Bins above Nyquist
+		are set to 0.
+
+		frames holds numFrames * numChannels pointers, channel c of frame f at
+		index f * numChannels + c, as StftFrames::getFrames() lays them out;
+		only the last hopLength samples of each are read. out is laid out the
+		same way.
+		*/
+		void calcMagnitudes(const float* const* frames, float* const* out, int numFrames, float scalingFactor);
+
+	private:
+		// Bins on either side that the widest cosine-sum window combines.
+		static const int MAX_TERMS = 3;
+
+		int numChannels = 0;
+		int length = 0;
+		int hopLength = 0;
+		int numBins = 0;
+
+		// Sums are kept for bins 0..numSumBins - 1; the others follow by
+		// conjugate symmetry and periodicity.
+		int numSumBins = 0;
+
+		// W^n for n in [0, length).
+		std::vector<double> twiddleReal;
+		std::vector<double> twiddleImag;
+
+		// Per channel: the sums of bins -MAX_TERMS..numSumBins + MAX_TERMS - 1,
+		// of which the ones outside 0..numSumBins - 1 are copied in from their
+		// conjugates before every readout, and the last length samples, the
+		// oldest at position.
+		int sumStride = 0;
+		std::vector<double> sumsReal;
+		std::vector<double> sumsImag;
+		std::vector<float> delayLines;
+		int position = 0;
+
+		// W^(k n) of every bin for each sample of the current hop, hop-major,
+		// and what each sample of the hop adds to one channel's sums.
+		std::vector<double> rotationsReal;
+		std::vector<double> rotationsImag;
+		std::vector<double> deltas;
+
+		// The window's coefficient of bin k + p in output bin k, for p from
+		// -MAX_TERMS to MAX_TERMS; 0 beyond numTerms.
+		int numTerms = 0;
+		double termCoefficients[2 * MAX_TERMS + 1] = {};
+
+		// Where the padding bins below 0 and above numSumBins - 1 come from:
+		// the index of a sum, or -1 for bins that are never read, and the
+		// sign of its imaginary part, -1 where the bin is its conjugate.
+		int padSources[2 * MAX_TERMS] = {};
+		double padImagSigns[2 * MAX_TERMS] = {};
+
+		// The output bins of one channel, interleaved (re, im, re, im, ...).
+		std::vector<float> spectrum;
+	};
+}
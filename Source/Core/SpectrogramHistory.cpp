@@ -0,0 +1,185 @@
+#include <algorithm>
+#include <cmath>
+
+#include "SimdKernels.h"
+#include "SpectrogramHistory.h"
+
+using namespace SpectrogramViewer;
+
+void SpectrogramHistory::resize(
+	int numColumns_,
+	int numRows_,
+	int maxColumnsAhead_,
+	HistoryFormat format_,
+	float minLog10_,
+	float maxLog10_)
+{
+	numColumns = numColumns_;
+	numRows = numRows_;
+	maxColumnsAhead = std::max(0, std::min(maxColumnsAhead_, numColumns - 1));
+	format = format_;
+	minLog10 = minLog10_;
+	maxLog10 = maxLog10_;
+	head = 0;
+
+	// Release the storage of the other formats rather than just emptying it.
+	int numValues = numColumns * numRows;
+	std::vector<float>(format == HISTORY_FLOAT ? numValues : 0, NAN).swap(values);
+	std::vector<uint8_t>(format == HISTORY_LEVELS_8 ? numValues : 0, 0).swap(levels8);
+	std::vector<uint16_t>(format == HISTORY_LEVELS_16 ? numValues : 0, 0).swap(levels16);
+	std::vector<ColumnInfo>(numColumns).swap(infos);
+	std::vector<float>(format == HISTORY_FLOAT ? 0 : (maxColumnsAhead + 1) * numRows, 0.f).swap(staging);
+
+	numColumnsWritten.store(0, std::memory_order_release);
+}
+
+int SpectrogramHistory::getNumLevels() const
+{
+	switch (format)
+	{
+	case HISTORY_LEVELS_8:
+		return 1 << 8;
+	case HISTORY_LEVELS_16:
+		return 1 << 16;
+	default:
+		return 0;
+	}
+}
+
+void SpectrogramHistory::finishColumn(const ColumnInfo& info)
+{
+	infos[head] = info;
+
+	if (format != HISTORY_FLOAT)
+	{
+		auto& kernels = getSimdKernels();
+		auto magnitudes = getNextColumn();
+		int slot = head * numRows;
+
+		// Same mapping as ColorQuantizer: level = log10(value) * levelsPerLog10 + offset.
+		const float log10Of2 = 0.30102999566f;
+		float levelsPerLog10 = getNumLevels() / (maxLog10 - minLog10);
+		float offset = -minLog10 * levelsPerLog10;
+
+		if (format == HISTORY_LEVELS_8)
+		{
+			kernels.logQuantize(
+				magnitudes, levels8.data() + slot, numRows,
+				levelsPerLog10 * log10Of2, offset, getNumLevels() - 1);
+		}
+		else
+		{
+			// The staging is scratch once finished, so the log can go in place.
+			kernels.toDecibels(magnitudes, magnitudes, numRows, 1.f, 20.f);
+			kernels.quantize16(
+				magnitudes, levels16.data() + slot, numRows,
+				levelsPerLog10 / 20, offset, getNumLevels() - 1);
+		}
+	}
+
+	publishColumn();
+}
+
+void SpectrogramHistory::publishColumn()
+{
+	head++;
+
+	if (head == numColumns)
+	{
+		head = 0;
+	}
+
+	// The increment releases the finished column. The fence then keeps the
+	// writes into the reused slots that follow from becoming visible before
+	// it, so a reader that sees any of them also sees the new count.
+	numColumnsWritten.fetch_add(1, std::memory_order_seq_cst);
+	std::atomic_thread_fence(std::memory_order_release);
+}
+
+int SpectrogramHistory::copyNewColumnsFrom(const SpectrogramHistory& source)
+{
+	int64_t sourceEnd = source.getNumColumnsWritten();
+	int64_t copiedTo = numColumnsWritten.load(std::memory_order_relaxed);
+
+	bool formatChanged = format != source.format
+		|| minLog10 != source.minLog10
+		|| maxLog10 != source.maxLog10;
+
+	if (numColumns != source.numColumns || numRows != source.numRows || formatChanged || copiedTo > sourceEnd)
+	{
+		resize(source.numColumns, source.numRows, 0, source.format, source.minLog10, source.maxLog10);
+		copiedTo = 0;
+	}
+
+	if (numColumns == 0 || copiedTo == sourceEnd)
+	{
+		return 0;
+	}
+
+	// Columns older than this have already left both histories.
+	int64_t copyFrom = std::max(copiedTo, sourceEnd - numColumns);
+	int numNewColumns = sourceEnd - copyFrom;
+
+	// If we fell behind by more than a full history, every column gets replaced.
+	numColumnsWritten.store(copyFrom, std::memory_order_relaxed);
+	head = copyFrom % numColumns;
+
+	for (int64_t i = copyFrom; i < sourceEnd; i++)
+	{
+		copyColumn(source, i);
+		publishColumn();
+	}
+
+	// The writer starts overwriting column n as soon as it has published column
+	// n + numColumns - 1, or earlier by the number of columns it writes ahead.
+	// Anything at or before that point may have been torn while we copied it.
+	std::atomic_thread_fence(std::memory_order_acquire);
+	int64_t writerEnd = source.numColumnsWritten.load(std::memory_order_relaxed);
+	int64_t firstIntact = writerEnd - numColumns + 1 + source.maxColumnsAhead;
+
+	for (int64_t i = copyFrom; i < std::min(firstIntact, sourceEnd); i++)
+	{
+		clearColumn(i);
+	}
+
+	return numNewColumns;
+}
+
+void SpectrogramHistory::copyColumn(const SpectrogramHistory& source, int64_t sequenceNumber)
+{
+	int from = (sequenceNumber % numColumns) * numRows;
+	int to = head * numRows;
+	infos[head] = source.infos[sequenceNumber % numColumns];
+
+	switch (format)
+	{
+	case HISTORY_FLOAT:
+		std::copy(source.values.data() + from, source.values.data() + from + numRows, values.data() + to);
+		break;
+	case HISTORY_LEVELS_8:
+		std::copy(source.levels8.data() + from, source.levels8.data() + from + numRows, levels8.data() + to);
+		break;
+	case HISTORY_LEVELS_16:
+		std::copy(source.levels16.data() + from, source.levels16.data() + from + numRows, levels16.data() + to);
+		break;
+	}
+}
+
+void SpectrogramHistory::clearColumn(int64_t sequenceNumber)
+{
+	int from = (sequenceNumber % numColumns) * numRows;
+	infos[sequenceNumber % numColumns] = ColumnInfo();
+
+	switch (format)
+	{
+	case HISTORY_FLOAT:
+		std::fill(values.data() + from, values.data() + from + numRows, NAN);
+		break;
+	case HISTORY_LEVELS_8:
+		std::fill(levels8.data() + from, levels8.data() + from + numRows, 0);
+		break;
+	case HISTORY_LEVELS_16:
+		std::fill(levels16.data() + from, levels16.data() + from + numRows, 0);
+		break;
+	}
+}
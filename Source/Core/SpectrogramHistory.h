@@ -0,0 +1,198 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "ColorMap.h"
+
+namespace SpectrogramViewer
+{
+	/** How a SpectrogramHistory stores its values. */
+	enum HistoryFormat
+	{
+		/** The values as written, NaN for no data. */
+		HISTORY_FLOAT = 0,
+
+		/** Magnitudes log-quantized to 256 levels, 0 for no data. Level L covers
+		log10 magnitudes from minLog10 + L * step to minLog10 + (L + 1) * step,
+		where step = (maxLog10 - minLog10) / 256; level 0 also takes everything
+		below, the last level everything above. Over the colour scale's range,
+		the levels are the palette indices. */
+		HISTORY_LEVELS_8 = 1,
+
+		/** As HISTORY_LEVELS_8, with 65536 levels. */
+		HISTORY_LEVELS_16 = 2
+	};
+
+	/** Where a column of a SpectrogramHistory comes from. */
+	struct ColumnInfo
+	{
+		/** Sample number, on the processor's sample clock, of the first input
+		sample that the column covers; -1 if unknown. */
+		int64_t firstSample = -1;
+
+		/** Number of input samples that the column covers. */
+		int numSamples = 0;
+	};
+
+	/** Fixed-length history of spectrogram columns, stored as a ring buffer.
+
+	Appending a column is O(1): the column is written into the slot holding the
+	oldest one and the head index moves forward. Readers address columns from
+	oldest (0) to newest (getNumColumns() - 1) without the storage being linearized.
+
+	A history can be shared between one writer thread and one reader thread
+	without locks. The writer publishes every finished column through an atomic
+	column counter. The reader keeps its own SpectrogramHistory and calls
+	copyNewColumnsFrom() to pull in only the columns it has not seen yet.
+	Neither side ever waits for the other.
+
+	The memory ordering works like a seqlock over the whole ring:
+	- The writer finishes a column and then increments the counter. The
+	  increment releases the column's values and ColumnInfo. A release fence
+	  follows it, before any write to the next slot, so no write into a
+	  reused slot can be seen before the count that allows it.
+	- The reader acquires the counter and copies the columns below it. Then it
+	  issues an acquire fence and reads the counter again. Any copied value
+	  that came from a later overwrite is ordered before that second read, so
+	  the read sees a count high enough to flag the column as torn. Such
+	  columns are cleared rather than shown.
+	The slots themselves are plain memory. The reader may race with an
+	overwrite, but it only keeps columns that the second read proves intact.
+
+	The values can also be stored as 8- or 16-bit log-quantized levels (see
+	HistoryFormat), which cuts the memory, and the bandwidth of copying and
+	drawing, by 4 or 2 times. The writer does not need to know: it still
+	writes magnitudes through getNextColumn(), into a few columns of float
+	staging, and finishColumn() quantizes them into the history.
+	*/
+	class SpectrogramHistory
+	{
+	public:
+		/** Sets the history dimensions and format, and fills every column with
+		no data. Must not run concurrently with copyNewColumnsFrom() on the
+		same object.
+
+		maxColumnsAhead is how many columns beyond the next one the writer may
+		fill before finishing them; see getNextColumn(). It is kept below
+		numColumns. minLog10 and maxLog10 are the range of the levels of the
+		quantized formats, as log10 of the magnitudes. */
+		void resize(
+			int numColumns,
+			int numRows,
+			int maxColumnsAhead = 0,
+			HistoryFormat format = HISTORY_FLOAT,
+			float minLog10 = DEFAULT_MIN_LOG10,
+			float maxLog10 = DEFAULT_MAX_LOG10);
+
+		int getNumColumns() const { return numColumns; }
+		int getNumRows() const { return numRows; }
+
+		HistoryFormat getFormat() const { return format; }
+		float getMinLog10() const { return minLog10; }
+		float getMaxLog10() const { return maxLog10; }
+
+		/** Returns the number of levels of the quantized formats, or 0. */
+		int getNumLevels() const;
+
+		/** Returns the total number of columns appended since the last resize(). */
+		int64_t getNumColumnsWritten() const { return numColumnsWritten.load(std::memory_order_acquire); }
+
+		int getMaxColumnsAhead() const { return maxColumnsAhead; }
+
+		/** Returns the storage for the next column. The column becomes part of
+		the history once finishColumn() is called.
+
+		With ahead > 0, returns the storage of the column that follows it by that
+		many columns, so that a batch of columns can be written at once and then
+		finished in order. ahead must not exceed getMaxColumnsAhead().
+
+		In the quantized formats, the column is staging that holds magnitudes
+		until it is finished. */
+		float* getNextColumn(int ahead = 0)
+		{
+			if (format != HISTORY_FLOAT)
+			{
+				int64_t sequenceNumber = numColumnsWritten.load(std::memory_order_relaxed) + ahead;
+				return &staging[(sequenceNumber % (maxColumnsAhead + 1)) * numRows];
+			}
+
+			return &values[getSlot(ahead) * numRows];
+		}
+
+		/** Appends the column written via getNextColumn(), dropping the oldest one,
+		and publishes it to readers along with info. */
+		void finishColumn(const ColumnInfo& info = ColumnInfo());
+
+		/** Returns the column at the given age, where 0 is the oldest column.
+		Only safe on the writer thread, or on a copy owned by the reader.
+		The variant called must match the format. */
+		const float* getColumn(int index) const { return &values[getSlot(index) * numRows]; }
+		const uint8_t* getColumnLevels8(int index) const { return &levels8[getSlot(index) * numRows]; }
+		const uint16_t* getColumnLevels16(int index) const { return &levels16[getSlot(index) * numRows]; }
+
+		/** Returns the info of the column at the given age; same rules as getColumn(). */
+		const ColumnInfo& getColumnInfo(int index) const { return infos[getSlot(index)]; }
+
+		/** Appends the columns that the source has published since the last call.
+
+		Call this on a history owned by the reader thread; source may be written
+		concurrently by its writer thread. If the dimensions of the source have
+		changed, or it has been reset, this history is resized to match first.
+		Columns that the writer overwrote while they were being copied are
+		stored as no data, so a torn column is never shown.
+
+		@returns the number of columns appended.
+		*/
+		int copyNewColumnsFrom(const SpectrogramHistory& source);
+
+	private:
+		// Only the vector of the current format is allocated.
+		std::vector<float> values;
+		std::vector<uint8_t> levels8;
+		std::vector<uint16_t> levels16;
+		std::vector<ColumnInfo> infos;
+
+		// Columns being written, maxColumnsAhead + 1 of them, in the quantized
+		// formats. Column n is staged in slot n % (maxColumnsAhead + 1).
+		std::vector<float> staging;
+
+		int numColumns = 0;
+		int numRows = 0;
+		int maxColumnsAhead = 0;
+
+		HistoryFormat format = HISTORY_FLOAT;
+		float minLog10 = DEFAULT_MIN_LOG10;
+		float maxLog10 = DEFAULT_MAX_LOG10;
+
+		// Slot of the oldest column, which is also where the next column goes.
+		int head = 0;
+
+		// Incremented after each column is finished. The column with sequence
+		// number n lives in slot n % numColumns.
+		std::atomic<int64_t> numColumnsWritten { 0 };
+
+		int getSlot(int offset) const
+		{
+			int slot = head + offset;
+
+			if (slot >= numColumns)
+			{
+				slot -= numColumns;
+			}
+
+			return slot;
+		}
+
+		/** Moves the head past the column in its slot and publishes it. */
+		void publishColumn();
+
+		/** Copies column sequenceNumber of source, which has the same format,
+		and its info into the slot at the head. */
+		void copyColumn(const SpectrogramHistory& source, int64_t sequenceNumber);
+
+		/** Fills the column with the given sequence number with no data. */
+		void clearColumn(int64_t sequenceNumber);
+	};
+}
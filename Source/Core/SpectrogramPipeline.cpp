@@ -0,0 +1,689 @@
+#include <algorithm>
+#include <cmath>
+
+#include "SpectrogramPipeline.h"
+#include "SimdKernels.h"
+
+using namespace SpectrogramViewer;
+
+namespace
+{
+	/** Reads a column of a history as log10 magnitudes, NaN for no data.
+	decibels tells whether a float history holds dB. Quantized levels are
+	taken at the middle of their range; level 0, which is both no data and
+	anything below the range, comes out at the bottom of it. */
+	void readLog10Column(const SpectrogramHistory& history, int index, bool decibels, float* out)
+	{
+		int numRows = history.getNumRows();
+		float log10PerLevel = 0;
+
+		if (history.getFormat() != HISTORY_FLOAT)
+		{
+			log10PerLevel = (history.getMaxLog10() - history.getMinLog10()) / history.getNumLevels();
+		}
+
+		for (int r = 0; r < numRows; r++)
+		{
+			int level = 0;
+
+			switch (history.getFormat())
+			{
+			case HISTORY_FLOAT:
+				out[r] = decibels ? history.getColumn(index)[r] / 20 : std::log10(history.getColumn(index)[r]);
+				continue;
+			case HISTORY_LEVELS_8:
+				level = history.getColumnLevels8(index)[r];
+				break;
+			case HISTORY_LEVELS_16:
+				level = history.getColumnLevels16(index)[r];
+				break;
+			}
+
+			out[r] = history.getMinLog10() + (level + 0.5f) * log10PerLevel;
+		}
+	}
+}
+
+SpectrogramPipeline::SpectrogramPipeline(
+	const SpectrogramSettings& settings,
+	const std::vector<int>& channels,
+	double sampleRate,
+	const SpectrogramPipeline* previous,
+	bool keepHistory)
+	: settings(settings), channels(channels), inputSampleRate(sampleRate)
+{
+	// The channels are assumed to share the sample rate of the first one.
+	int numChannels = channels.size();
+
+	// Frequency resolution comes from the window; time resolution from the
+	// step. The bin count is nominal until the decimated rate is known.
+	numLinearBins = std::floor((settings.maxShownFrequency - settings.minShownFrequency) * settings.windowLengthSec) + 1;
+	freqsPerSpectrogramColumn = numLinearBins;
+
+	// On a log axis the rows are log-spaced instead: wavelet scales, or
+	// groups of linear bins.
+	useLogBins = settings.isLogFrequencyAxis() && !settings.isWavelet();
+
+	if (settings.isLogFrequencyAxis())
+	{
+		double numOctaves = std::log2(settings.maxShownFrequency / settings.getLowestShownFrequency());
+		freqsPerSpectrogramColumn = std::max(2, (int)std::round(numOctaves * settings.scalesPerOctave) + 1);
+	}
+
+	// Nothing outside the shown band is displayed, so the FFTs run on a copy of
+	// the input resampled to just above what the band needs. In band mode the
+	// band is first shifted so that its middle row lands on 0 Hz; the decimator
+	// then only has to keep half the band, on the real and imaginary parts.
+	int numFftChannels = numChannels;
+	double passbandHz = settings.maxShownFrequency;
+	bandFirstBin = 0;
+
+	if (settings.isBandMode())
+	{
+		int middleRow = (numLinearBins - 1) / 2;
+		int numRowsAboveMiddle = numLinearBins - 1 - middleRow;
+		numFftChannels = 2 * numChannels;
+		passbandHz = std::max(1, std::max(middleRow, numRowsAboveMiddle)) / settings.windowLengthSec;
+
+		// The actual bin spacing is only known after decimation, and padding
+		// makes the bins finer, so the rows can reach up to a bin further out
+		// on either side.
+		passbandHz += 1 / settings.windowLengthSec;
+	}
+
+	if (settings.isWavelet())
+	{
+		// Keep the upper tail of the highest wavelet too.
+		passbandHz = settings.maxShownFrequency * (1 + MORLET_TAIL_SIGMAS / settings.waveletCycles);
+	}
+
+	decimator.prepare(numFftChannels, sampleRate, passbandHz, DECIMATOR_BLOCK_SIZE);
+	auto fftSampleRate = decimator.getOutputRate();
+	int maxDecimatedSize = decimator.getMaxOutputSize(DECIMATOR_BLOCK_SIZE);
+
+	inputBlock.resize(numChannels * DECIMATOR_BLOCK_SIZE);
+	mixedBlock.resize(settings.isBandMode() ? numFftChannels * DECIMATOR_BLOCK_SIZE : 0);
+	decimatedBlock.resize(numFftChannels * maxDecimatedSize);
+	inputBlockRows.resize(numChannels);
+	mixedBlockRows.resize(settings.isBandMode() ? numFftChannels : 0);
+	decimatedBlockRows.resize(numFftChannels);
+	frameInputs.resize(numFftChannels);
+
+	for (int i = 0; i < numChannels; i++)
+	{
+		inputBlockRows[i] = &inputBlock[i * DECIMATOR_BLOCK_SIZE];
+	}
+
+	for (int i = 0; i < (int)mixedBlockRows.size(); i++)
+	{
+		mixedBlockRows[i] = &mixedBlock[i * DECIMATOR_BLOCK_SIZE];
+	}
+
+	for (int i = 0; i < numFftChannels; i++)
+	{
+		decimatedBlockRows[i] = &decimatedBlock[i * maxDecimatedSize];
+	}
+
+	samplesPerStep = std::max(1, (int)std::round(fftSampleRate * settings.stepLengthSec));
+	windowLength = std::max(1, (int)std::round(fftSampleRate * settings.windowLengthSec));
+
+	// Windows can be zero-padded to a length with only small prime factors,
+	// which pocketfft transforms much faster than e.g. 1110 = 2 * 3 * 5 * 37.
+	// Padding only makes the bins finer: the levels depend on the windowed
+	// samples alone, so the scaling in calcSpectrograms() is unchanged.
+	fftLength = settings.padFftToFastLength ? RealFft::getFastLength(windowLength) : windowLength;
+
+	// The window is a whole number of decimated samples, so the bins are
+	// only nominally 1 / windowLengthSec apart; e.g. 50 ms at 150 Hz is 8
+	// samples, and 18.75 Hz bins. The rows follow the actual bins.
+	binSpacingHz = fftSampleRate / fftLength;
+	numLinearBins = std::floor((settings.maxShownFrequency - settings.minShownFrequency) / binSpacingHz + 1e-6) + 1;
+	freqsPerSpectrogramColumn = useLogBins ? freqsPerSpectrogramColumn : numLinearBins;
+	bandFirstBin = settings.isBandMode() ? -((numLinearBins - 1) / 2) : 0;
+
+	if (settings.isBandMode())
+	{
+		heterodyne.prepare(settings.minShownFrequency - bandFirstBin * binSpacingHz, sampleRate, DECIMATOR_BLOCK_SIZE);
+	}
+
+	// A decimated block can complete several steps; they are transformed
+	// together, up to a batch size that keeps the frame rings and the number
+	// of history columns written ahead small.
+	int numStepsToShow = std::max(1, (int)std::round(settings.chartLengthSec / settings.stepLengthSec));
+	maxFramesPerBatch = std::min({ MAX_FRAMES_PER_BATCH, numStepsToShow, maxDecimatedSize / samplesPerStep + 1 });
+	stftFrames.prepare(numFftChannels, windowLength, samplesPerStep, maxFramesPerBatch);
+
+	// The window only changes with the configuration, so it is computed here
+	// once and applied by the FFT as it copies each frame in.
+	auto window = makeWindow(WindowFunction(settings.windowFunction), windowLength);
+
+	if (settings.isWavelet())
+	{
+		cwt.prepare(
+			numChannels, fftSampleRate, settings.getLowestShownFrequency(), settings.maxShownFrequency,
+			freqsPerSpectrogramColumn, settings.waveletCycles, samplesPerStep, settings.numFftThreads);
+	}
+	else if (settings.isBandMode())
+	{
+		bandFft.prepare(fftLength, settings.numFftThreads, windowLength);
+		bandFft.setWindow(window);
+	}
+	else if (settings.isMultitaper())
+	{
+		// The tapers take a while to compute for long windows; take those of
+		// the previous pipeline unless their (N, NW, K) changed.
+		if (previous)
+		{
+			tapers = previous->tapers;
+			taperLength = previous->taperLength;
+			taperTimeHalfBandwidth = previous->taperTimeHalfBandwidth;
+		}
+
+		if ((int)tapers.size() != settings.numTapers || taperLength != windowLength || taperTimeHalfBandwidth != settings.timeHalfBandwidth)
+		{
+			tapers = makeDpssTapers(windowLength, settings.timeHalfBandwidth, settings.numTapers);
+			taperLength = windowLength;
+			taperTimeHalfBandwidth = settings.timeHalfBandwidth;
+		}
+
+		fft.prepare(fftLength, settings.numFftThreads, windowLength);
+		fft.setWindows(tapers);
+
+		// All tapers have the same (unit) energy, so the first one sets the scaling.
+		window = tapers[0];
+	}
+	else
+	{
+		// An FFT of every frame costs the same whatever the hop, while a
+		// sliding DFT costs in proportion to it, so short hops over long
+		// windows go to the latter. It cannot zero-pad, and it runs on the
+		// worker thread alone.
+		auto windowFunction = WindowFunction(settings.windowFunction);
+		useSlidingDft = fftLength == windowLength
+			&& samplesPerStep < windowLength
+			&& SlidingDft::supportsWindow(windowFunction)
+			&& SlidingDft::estimateCost(samplesPerStep, numLinearBins)
+				< RealFft::estimateCost(fftLength) / std::max(1, settings.numFftThreads);
+
+		if (useSlidingDft)
+		{
+			slidingDft.prepare(numChannels, windowLength, samplesPerStep, numLinearBins, windowFunction);
+		}
+		else
+		{
+			fft.prepare(fftLength, settings.numFftThreads, windowLength);
+			fft.setWindow(window);
+		}
+	}
+
+	double sumOfSquares = 0;
+
+	for (auto value : window)
+	{
+		sumOfSquares += value * value;
+	}
+
+	// All incoming data is in microvolts. White noise of density D has
+	// E|X|^2 = D^2 fs sum(w^2) / 2 in every bin, folded to one side. A tone in
+	// band mode is mixed down without doubling, so it has the same bin
+	// magnitude as in a real transform and shares the scaling.
+	densityScaling = float(std::sqrt(2 / (fftSampleRate * sumOfSquares)) / 1000000);
+
+	// Expected cost of one step, for the editor. A complex transform costs
+	// about as much as two real ones of the same length.
+	double stepCost = 0;
+
+	if (settings.isWavelet())
+	{
+		int cwtLength = cwt.getFftLength();
+		int cwtBlockLength = cwtLength - 2 * cwt.getLatency();
+		stepCost = (1 + cwt.getNumScales()) * 2 * RealFft::estimateCost(cwtLength) * samplesPerStep / cwtBlockLength;
+	}
+	else if (settings.isBandMode())
+	{
+		stepCost = 2 * RealFft::estimateCost(fftLength);
+	}
+	else if (useSlidingDft)
+	{
+		stepCost = SlidingDft::estimateCost(samplesPerStep, numLinearBins);
+	}
+	else
+	{
+		stepCost = fft.getNumWindows() * RealFft::estimateCost(fftLength);
+	}
+
+	estimatedStepCostUs = numChannels * stepCost / 1000;
+
+	// A frame covers a window; a wavelet column the step it averages over.
+	columnLengthSamples = (settings.isWavelet() ? samplesPerStep : windowLength) * decimator.getFactor();
+
+	// The FIFO holds half a second on top of a full step; under the drop policy
+	// the worker lets the backlog grow to at most 100 ms beyond a step.
+	int inputSamplesPerStep = samplesPerStep * decimator.getFactor();
+	inputFifo.resize(numChannels, inputSamplesPerStep + std::round(sampleRate * 0.5f));
+	inputPointers.resize(numChannels);
+	maxLagSamples = inputSamplesPerStep + std::round(sampleRate * 0.1f);
+
+	spectrograms.resize(numChannels);
+	welchAccumulators.resize(numChannels);
+	fftOutputs.resize(maxFramesPerBatch * numChannels);
+	bandRealFrames.resize(settings.isBandMode() ? maxFramesPerBatch * numChannels : 0);
+	bandImagFrames.resize(bandRealFrames.size());
+
+	if (useLogBins)
+	{
+		logBins.prepare(
+			settings.minShownFrequency, binSpacingHz, numLinearBins,
+			settings.getLowestShownFrequency(), settings.maxShownFrequency, freqsPerSpectrogramColumn);
+	}
+
+	linearOutputs.resize(useLogBins ? fftOutputs.size() : 0);
+	linearColumns.resize(linearOutputs.size() * numLinearBins);
+
+	for (int i = 0; i < (int)linearOutputs.size(); i++)
+	{
+		linearOutputs[i] = &linearColumns[i * numLinearBins];
+	}
+
+	for (int i = 0; i < numChannels; i++)
+	{
+		spectrograms[i].reset(new SpectrogramHistory());
+		spectrograms[i]->resize(
+			numStepsToShow, freqsPerSpectrogramColumn, maxFramesPerBatch - 1,
+			settings.historyFormat, DEFAULT_MIN_LOG10, DEFAULT_MAX_LOG10);
+
+		welchAccumulators[i].reset(new WelchAccumulator());
+		welchAccumulators[i]->resize(settings.numWelchSegments, freqsPerSpectrogramColumn);
+	}
+
+	rowFrequencies.resize(freqsPerSpectrogramColumn);
+
+	for (int r = 0; r < freqsPerSpectrogramColumn; r++)
+	{
+		if (settings.isWavelet())
+		{
+			rowFrequencies[r] = cwt.getScaleFrequency(r);
+		}
+		else if (useLogBins)
+		{
+			rowFrequencies[r] = logBins.getRowFrequency(r);
+		}
+		else
+		{
+			// Band mode starts at the lowest shown frequency; otherwise that is 0.
+			rowFrequencies[r] = settings.minShownFrequency + r * binSpacingHz;
+		}
+	}
+
+	if (previous && keepHistory)
+	{
+		carryOverHistory(*previous);
+	}
+}
+
+int SpectrogramPipeline::write(const float* const* inputs, int numSamples, int64_t firstSample)
+{
+	for (int i = 0; i < (int)channels.size(); i++)
+	{
+		inputPointers[i] = inputs[channels[i]];
+	}
+
+	// Tell the worker where the numbering jumps; the first call always does.
+	if (firstSample != nextSample)
+	{
+		int64_t numWritten = numAnchorsWritten.load(std::memory_order_relaxed);
+
+		if (numWritten - numAnchorsRead.load(std::memory_order_acquire) < MAX_ANCHORS)
+		{
+			anchors[numWritten % MAX_ANCHORS] = { numSamplesWritten, firstSample };
+			numAnchorsWritten.store(numWritten + 1, std::memory_order_release);
+		}
+	}
+
+	int numQueued = inputFifo.write(inputPointers.data(), numSamples);
+	numSamplesWritten += numQueued;
+	nextSample = firstSample + numQueued;
+	return numQueued;
+}
+
+void SpectrogramPipeline::restartStreams()
+{
+	heterodyne.reset();
+	decimator.reset();
+	stftFrames.clear();
+	slidingDft.reset();
+	cwt.reset();
+
+	resetSample += numSamplesRead - resetPosition;
+	resetPosition = numSamplesRead;
+	numColumnsSinceReset = 0;
+}
+
+int64_t SpectrogramPipeline::applyAnchors()
+{
+	int64_t numWritten = numAnchorsWritten.load(std::memory_order_acquire);
+	int64_t numRead = numAnchorsRead.load(std::memory_order_relaxed);
+	int64_t firstSample = -1;
+
+	// A skip can move past several anchors at once; the last one counts.
+	while (numRead < numWritten && anchors[numRead % MAX_ANCHORS].position <= numSamplesRead)
+	{
+		auto& anchor = anchors[numRead % MAX_ANCHORS];
+		firstSample = anchor.sampleNumber + (numSamplesRead - anchor.position);
+		numRead++;
+	}
+
+	int64_t numSamplesToAnchor = numRead < numWritten
+		? anchors[numRead % MAX_ANCHORS].position - numSamplesRead
+		: INT64_MAX;
+	numAnchorsRead.store(numRead, std::memory_order_release);
+
+	if (firstSample >= 0)
+	{
+		restartStreams();
+		resetSample = firstSample;
+	}
+
+	return numSamplesToAnchor;
+}
+
+int SpectrogramPipeline::processQueuedSamples(bool dropBacklog)
+{
+	int numQueued = inputFifo.getNumReady();
+	int numDropped = 0;
+
+	// One step in input samples, before decimation.
+	int inputSamplesPerStep = samplesPerStep * decimator.getFactor();
+
+	if (dropBacklog && numQueued > maxLagSamples)
+	{
+		// Skip whole steps to catch up, and restart the filters and frames from
+		// silence, since they would otherwise span the gap.
+		int numStepsBehind = (numQueued - maxLagSamples + inputSamplesPerStep - 1) / inputSamplesPerStep;
+		numDropped = inputFifo.skip(numStepsBehind * inputSamplesPerStep);
+		numSamplesRead += numDropped;
+		restartStreams();
+	}
+
+	// In band mode the decimator and the frames work on the mixed signals:
+	// the real parts of all channels followed by their imaginary parts.
+	auto decimatorInputs = inputBlockRows.data();
+
+	if (settings.isBandMode())
+	{
+		decimatorInputs = mixedBlockRows.data();
+	}
+
+	while (true)
+	{
+		// A block never spans a jump in the sample numbers.
+		int64_t numSamplesToAnchor = applyAnchors();
+		int numRead = inputFifo.read(inputBlockRows.data(), (int)std::min<int64_t>(DECIMATOR_BLOCK_SIZE, numSamplesToAnchor));
+
+		if (numRead == 0)
+		{
+			break;
+		}
+
+		numSamplesRead += numRead;
+
+		if (settings.isBandMode())
+		{
+			int numChannels = channels.size();
+			heterodyne.process(
+				inputBlockRows.data(), mixedBlockRows.data(), mixedBlockRows.data() + numChannels,
+				numChannels, numRead);
+		}
+
+		int numDecimated = decimator.process(decimatorInputs, numRead, decimatedBlockRows.data());
+
+		if (settings.isWavelet())
+		{
+			for (int offset = 0; offset < numDecimated;)
+			{
+				for (int i = 0; i < (int)frameInputs.size(); i++)
+				{
+					frameInputs[i] = decimatedBlockRows[i] + offset;
+				}
+
+				offset += cwt.append(frameInputs.data(), numDecimated - offset);
+
+				while (cwt.getNumReadyColumns() > 0)
+				{
+					calcWaveletColumns();
+				}
+			}
+
+			continue;
+		}
+
+		for (int offset = 0; offset < numDecimated;)
+		{
+			for (int i = 0; i < (int)frameInputs.size(); i++)
+			{
+				frameInputs[i] = decimatedBlockRows[i] + offset;
+			}
+
+			offset += stftFrames.append(frameInputs.data(), numDecimated - offset);
+
+			if (stftFrames.isBatchFull())
+			{
+				calcSpectrograms(stftFrames.getFrames(), stftFrames.getNumFrames());
+				stftFrames.clearFrames();
+			}
+		}
+
+		// Transform whatever this block completed in one go, rather than
+		// holding it back until the next block.
+		if (stftFrames.getNumFrames() > 0)
+		{
+			calcSpectrograms(stftFrames.getFrames(), stftFrames.getNumFrames());
+			stftFrames.clearFrames();
+		}
+	}
+
+	return numDropped;
+}
+
+void SpectrogramPipeline::calcSpectrograms(const float* const* frames, int numFrames)
+{
+	auto scalingFactor = densityScaling;
+
+	// The magnitudes go straight into the histories' next numFrames columns,
+	// in the same frame-major order as the frames.
+	int numChannels = spectrograms.size();
+	int numTransforms = numFrames * numChannels;
+
+	for (int f = 0; f < numFrames; f++)
+	{
+		for (int i = 0; i < numChannels; i++)
+		{
+			fftOutputs[f * numChannels + i] = spectrograms[i]->getNextColumn(f);
+		}
+	}
+
+	// On a log axis the engines fill the linear bins first.
+	auto engineOutputs = useLogBins ? linearOutputs.data() : fftOutputs.data();
+
+	// One batched call transforms every frame of every channel.
+	if (settings.isBandMode())
+	{
+		// Each band frame is the real parts of all channels followed by their
+		// imaginary parts; the transform takes them as two separate lists.
+		for (int f = 0; f < numFrames; f++)
+		{
+			for (int i = 0; i < numChannels; i++)
+			{
+				bandRealFrames[f * numChannels + i] = frames[(2 * f) * numChannels + i];
+				bandImagFrames[f * numChannels + i] = frames[(2 * f + 1) * numChannels + i];
+			}
+		}
+
+		bandFft.calcMagnitudes(
+			bandRealFrames.data(), bandImagFrames.data(), engineOutputs, numTransforms,
+			bandFirstBin, numLinearBins, scalingFactor);
+	}
+	else if (useSlidingDft)
+	{
+		slidingDft.calcMagnitudes(frames, engineOutputs, numFrames, scalingFactor);
+	}
+	else
+	{
+		fft.calcMagnitudes(
+			frames, engineOutputs, numTransforms,
+			numLinearBins, scalingFactor);
+	}
+
+	if (useLogBins)
+	{
+		for (int i = 0; i < numTransforms; i++)
+		{
+			logBins.apply(linearOutputs[i], fftOutputs[i]);
+		}
+	}
+
+	// Frame n since the restart ends (n + 1) steps in, zero-padded on the left.
+	publishColumns(numFrames, (numColumnsSinceReset + 1) * samplesPerStep - windowLength);
+}
+
+void SpectrogramPipeline::calcWaveletColumns()
+{
+	for (int i = 0; i < (int)spectrograms.size(); i++)
+	{
+		fftOutputs[i] = spectrograms[i]->getNextColumn();
+	}
+
+	// The transform works in the input's microvolts and already yields a
+	// density, so only the unit changes; see densityScaling.
+	cwt.readColumn(fftOutputs.data(), 1.f / 1000000);
+
+	// Column n since the restart averages step n, delayed by the centred kernels.
+	publishColumns(1, numColumnsSinceReset * samplesPerStep - cwt.getLatency());
+}
+
+void SpectrogramPipeline::publishColumns(int numColumns, int64_t firstDecimated)
+{
+	int numChannels = spectrograms.size();
+	int factor = decimator.getFactor();
+
+	for (int f = 0; f < numColumns; f++)
+	{
+		// Every channel's column at this step covers the same samples.
+		ColumnInfo info;
+		info.firstSample = resetSample + decimator.getOutputOffset() + (firstDecimated + f * samplesPerStep) * factor;
+		info.numSamples = columnLengthSamples;
+
+		for (int i = 0; i < numChannels; i++)
+		{
+			auto column = fftOutputs[f * numChannels + i];
+			welchAccumulators[i]->addColumn(column);
+			finishColumn(*spectrograms[i], column, info);
+		}
+	}
+
+	numColumnsSinceReset += numColumns;
+}
+
+void SpectrogramPipeline::finishColumn(SpectrogramHistory& history, float* column, const ColumnInfo& info)
+{
+	// The quantized histories take magnitudes and quantize them themselves.
+	if (settings.decibelOutput && settings.historyFormat == HISTORY_FLOAT)
+	{
+		getSimdKernels().toDecibels(column, column, freqsPerSpectrogramColumn, 1.f, 20.f);
+	}
+
+	history.finishColumn(info);
+}
+
+void SpectrogramPipeline::carryOverHistory(const SpectrogramPipeline& previous)
+{
+	auto& oldFrequencies = previous.getRowFrequencies();
+	int numOldRows = oldFrequencies.size();
+
+	if (numOldRows == 0)
+	{
+		return;
+	}
+
+	// Each new row is interpolated between the old rows on either side of
+	// its frequency, in log10 magnitude; -1 marks rows out of the old range.
+	std::vector<int> lowerRows(freqsPerSpectrogramColumn, -1);
+	std::vector<int> upperRows(freqsPerSpectrogramColumn, -1);
+	std::vector<float> upperWeights(freqsPerSpectrogramColumn, 0.f);
+
+	for (int r = 0; r < freqsPerSpectrogramColumn; r++)
+	{
+		double frequency = rowFrequencies[r];
+
+		if (frequency < oldFrequencies.front() || frequency > oldFrequencies.back())
+		{
+			continue;
+		}
+
+		int upper = std::upper_bound(oldFrequencies.begin(), oldFrequencies.end(), frequency) - oldFrequencies.begin();
+		upperRows[r] = std::min(upper, numOldRows - 1);
+		lowerRows[r] = std::max(0, upper - 1);
+
+		if (upperRows[r] != lowerRows[r])
+		{
+			upperWeights[r] = (frequency - oldFrequencies[lowerRows[r]])
+				/ (oldFrequencies[upperRows[r]] - oldFrequencies[lowerRows[r]]);
+		}
+	}
+
+	// The newest columns of both line up; each step back in the new history
+	// goes back this many old steps.
+	double oldStepsPerStep = settings.stepLengthSec / previous.settings.stepLengthSec;
+	std::vector<float> oldColumn(numOldRows);
+
+	for (int i = 0; i < (int)channels.size(); i++)
+	{
+		auto it = std::lower_bound(previous.channels.begin(), previous.channels.end(), channels[i]);
+
+		if (it == previous.channels.end() || *it != channels[i])
+		{
+			continue;
+		}
+
+		// The previous pipeline may still be running; take a consistent copy.
+		SpectrogramHistory snapshot;
+		snapshot.copyNewColumnsFrom(previous.getSpectrogram(it - previous.channels.begin()));
+		int numOldColumns = std::min<int64_t>(snapshot.getNumColumnsWritten(), snapshot.getNumColumns());
+
+		auto& history = *spectrograms[i];
+		int numColumns = 0;
+
+		while (numColumns < history.getNumColumns() && std::round(numColumns * oldStepsPerStep) < numOldColumns)
+		{
+			numColumns++;
+		}
+
+		for (int age = numColumns - 1; age >= 0; age--)
+		{
+			int oldIndex = snapshot.getNumColumns() - 1 - (int)std::round(age * oldStepsPerStep);
+			readLog10Column(snapshot, oldIndex, previous.settings.decibelOutput, oldColumn.data());
+
+			auto column = history.getNextColumn();
+
+			for (int r = 0; r < freqsPerSpectrogramColumn; r++)
+			{
+				if (lowerRows[r] < 0)
+				{
+					column[r] = NAN;
+					continue;
+				}
+
+				float log10Magnitude = oldColumn[lowerRows[r]];
+
+				if (upperWeights[r] > 0)
+				{
+					log10Magnitude += (oldColumn[upperRows[r]] - log10Magnitude) * upperWeights[r];
+				}
+
+				column[r] = std::pow(10.f, log10Magnitude);
+			}
+
+			finishColumn(history, column, snapshot.getColumnInfo(oldIndex));
+		}
+	}
+}
@@ -0,0 +1,312 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "ComplexFft.h"
+#include "Decimator.h"
+#include "Heterodyne.h"
+#include "LogFrequencyBins.h"
+#include "MorletCwt.h"
+#include "RealFft.h"
+#include "SampleFifo.h"
+#include "SlidingDft.h"
+#include "SpectrogramHistory.h"
+#include "StftFrames.h"
+#include "WelchAccumulator.h"
+#include "WindowFunctions.h"
+
+namespace SpectrogramViewer
+{
+	/** The parameters that a SpectrogramPipeline is built from. */
+	struct SpectrogramSettings
+	{
+		/** Frequency of the bottom row of a log-frequency axis when
+		minShownFrequency is 0. */
+		static constexpr float DEFAULT_LOG_MIN_FREQ = 2;
+
+		float maxShownFrequency = 300;
+		float minShownFrequency = 0;
+		float stepLengthSec = 0.1;
+		float windowLengthSec = 0.1;
+		int windowFunction = WINDOW_HANN;
+		int numTapers = 1;
+		float timeHalfBandwidth = 3;
+		int numWelchSegments = 10;
+		float waveletCycles = 0;
+		int scalesPerOctave = 12;
+		bool logFrequencyAxis = false;
+		bool padFftToFastLength = false;
+		bool decibelOutput = true;
+		HistoryFormat historyFormat = HISTORY_FLOAT;
+		float chartLengthSec = 5;
+		int numFftThreads = 1;
+
+		/** Wavelet mode is on when the number of Morlet cycles is above 0. */
+		bool isWavelet() const { return waveletCycles > 0; }
+
+		/** Band (zoom FFT) mode is on whenever the lower bound of the shown
+		frequencies is above 0 Hz, outside wavelet mode. */
+		bool isBandMode() const { return minShownFrequency > 0 && !isWavelet(); }
+
+		/** Multitaper mode is on when more than one taper is requested, in the
+		plain FFT mode. */
+		bool isMultitaper() const { return numTapers > 1 && !isBandMode() && !isWavelet(); }
+
+		/** Wavelet rows are always log-spaced; the FFT rows when logFrequencyAxis is set. */
+		bool isLogFrequencyAxis() const { return isWavelet() || logFrequencyAxis; }
+
+		/** Returns the frequency of the bottom row. */
+		float getLowestShownFrequency() const
+		{
+			return (isLogFrequencyAxis() && minShownFrequency <= 0) ? DEFAULT_LOG_MIN_FREQ : minShownFrequency;
+		}
+	};
+
+	/** Everything that turns the samples of a set of channels into spectrogram
+	columns for one configuration: the input FIFO, decimator, frames,
+	transforms and histories.
+
+	The node never changes a pipeline in place. A configuration change builds
+	a new one on the message thread, where allocating and planning are fine,
+	and publishes it; the audio thread starts writing to it at its next buffer
+	and the worker thread follows. So neither ever sees a half-built
+	configuration, and the audio thread never allocates or waits.
+
+	Threads: the constructor runs before the pipeline is published; afterwards
+	write() is only called from the audio thread, processQueuedSamples() only
+	from the worker, and the histories are read through
+	SpectrogramHistory::copyNewColumnsFrom().
+	*/
+	class SpectrogramPipeline
+	{
+	public:
+		/** Builds a pipeline for the given input channel indices, in ascending
+		order, sampled at sampleRate.
+
+		previous is the pipeline this one replaces, if any. Its DPSS tapers are
+		reused if they match. With keepHistory, the histories of the channels
+		that both pipelines have start out with its columns so far, resampled
+		onto the new rows and step: linearly in frequency, to the nearest column
+		in time, whose ColumnInfo they keep. Rows outside its frequency range get
+		no data. previous may still be running; its histories are only read
+		through copyNewColumnsFrom(). */
+		SpectrogramPipeline(
+			const SpectrogramSettings& settings,
+			const std::vector<int>& channels,
+			double sampleRate,
+			const SpectrogramPipeline* previous = nullptr,
+			bool keepHistory = true);
+
+		const SpectrogramSettings& getSettings() const { return settings; }
+
+		/** Returns the input channels that spectrograms are computed for. */
+		const std::vector<int>& getChannels() const { return channels; }
+
+		/** Returns the sample rate of the input channels. */
+		double getInputSampleRate() const { return inputSampleRate; }
+
+		/** Queues numSamples samples of each of getChannels(). inputs holds
+		the samples of every input channel, indexed by channel, as in the
+		processor's buffer, and firstSample is the sample number of the first
+		of them. Never blocks or allocates.
+
+		Samples are numbered consecutively from there on. When firstSample
+		does not follow on from the previous call, e.g. because samples did not
+		fit, the worker restarts the filters and frames at the gap, as when it
+		drops a backlog, so that every column covers consecutive samples.
+
+		@returns the number of samples queued; the rest did not fit.
+		*/
+		int write(const float* const* inputs, int numSamples, int64_t firstSample);
+
+		/** Returns how many samples per channel are waiting for the worker thread. */
+		int getNumQueuedSamples() const { return inputFifo.getNumReady(); }
+
+		/** Turns all complete frames in the input FIFO into spectrogram columns.
+		With dropBacklog, a backlog of over 100 ms beyond a step is discarded
+		first, in whole steps.
+
+		@returns the number of samples per channel discarded.
+		*/
+		int processQueuedSamples(bool dropBacklog);
+
+		/** Returns the history of getChannels()[index]. */
+		const SpectrogramHistory& getSpectrogram(int index) const { return *spectrograms[index]; }
+
+		/** Returns the Welch averages of getChannels()[index]; see WelchAccumulator. */
+		const SpectrogramHistory& getWelchAverages(int index) const { return welchAccumulators[index]->getAverages(); }
+
+		/** Returns the centre frequency of each history row, in Hz, lowest first. */
+		const std::vector<double>& getRowFrequencies() const { return rowFrequencies; }
+
+		int getNumRows() const { return freqsPerSpectrogramColumn; }
+		int getWindowLengthSamples() const { return windowLength; }
+		int getFftLength() const { return settings.isWavelet() ? cwt.getFftLength() : fftLength; }
+
+		/** Returns the expected worker time per step for all channels, in
+		microseconds, from the cost models of the transforms. */
+		double getEstimatedStepCostUs() const { return estimatedStepCostUs; }
+
+		/** Returns true if the columns come from a SlidingDft rather than an
+		FFT of every frame. */
+		bool usesSlidingDft() const { return useSlidingDft; }
+
+	private:
+		SpectrogramSettings settings;
+		std::vector<int> channels;
+
+		// Samples of the channels on their way from the audio thread to the worker.
+		SampleFifo inputFifo;
+		std::vector<const float*> inputPointers;
+		double inputSampleRate = 0;
+
+		// Where the sample numbers jump: from FIFO position `position` on,
+		// samples are numbered from sampleNumber. A single-producer /
+		// single-consumer ring written by write(); if it is full, a gap goes
+		// unnoticed until the next one that fits.
+		struct SampleAnchor
+		{
+			int64_t position;
+			int64_t sampleNumber;
+		};
+
+		static const int MAX_ANCHORS = 64;
+		SampleAnchor anchors[MAX_ANCHORS];
+		std::atomic<int64_t> numAnchorsWritten { 0 };
+		std::atomic<int64_t> numAnchorsRead { 0 };
+
+		// Audio thread only: FIFO position and sample number of the next sample.
+		int64_t numSamplesWritten = 0;
+		int64_t nextSample = -1;
+
+		// Worker only: FIFO position of the next sample to read, and the FIFO
+		// position and sample number where the filters and frames last
+		// restarted, with the frames and wavelet columns produced since.
+		int64_t numSamplesRead = 0;
+		int64_t resetPosition = 0;
+		int64_t resetSample = 0;
+		int64_t numColumnsSinceReset = 0;
+
+		// Input samples covered by each column.
+		int columnLengthSamples = 0;
+
+		// Backlog above which the drop policy discards queued samples.
+		int maxLagSamples = 0;
+
+		// The worker moves queued samples through the decimator in blocks of at
+		// most DECIMATOR_BLOCK_SIZE samples per channel.
+		static const int DECIMATOR_BLOCK_SIZE = 4096;
+		Decimator decimator;
+		std::vector<float> inputBlock;
+		std::vector<float*> inputBlockRows;
+
+		// Band mode only: the input shifted down by the band's middle frequency.
+		Heterodyne heterodyne;
+		std::vector<float> mixedBlock;
+		std::vector<float*> mixedBlockRows;
+		std::vector<float> decimatedBlock;
+		std::vector<float*> decimatedBlockRows;
+		std::vector<const float*> frameInputs;
+
+		// Overlapping frames of the decimated channels, windowLength samples
+		// long and samplesPerStep apart. The window itself is applied by fft.
+		StftFrames stftFrames;
+		int samplesPerStep = 0;
+		int windowLength = 0;
+
+		// Transform length (windowLength, or more when padded) and the
+		// frequency step between its bins.
+		int fftLength = 0;
+		double binSpacingHz = 1;
+		double estimatedStepCostUs = 0;
+
+		// Frames completed by one decimated block are transformed in one call,
+		// at most this many per channel.
+		static const int MAX_FRAMES_PER_BATCH = 32;
+		int maxFramesPerBatch = 1;
+
+		RealFft fft;
+
+		// Plain FFT mode with short hops: the frames are fed to a sliding DFT
+		// instead, when its cost model beats the FFT's.
+		SlidingDft slidingDft;
+		bool useSlidingDft = false;
+
+		// Output columns of the current batch, frame-major like the frames.
+		std::vector<float*> fftOutputs;
+
+		// Log-frequency axis in the FFT modes only: the engines write
+		// numLinearBins linear bins per channel to linearColumns, which
+		// logBins then maps onto the history rows.
+		LogFrequencyBins logBins;
+		bool useLogBins = false;
+		int numLinearBins = 0;
+		std::vector<float> linearColumns;
+		std::vector<float*> linearOutputs;
+
+		// Band mode only: the transform of the mixed frames, and the bin of the
+		// lowest shown frequency relative to the band's middle.
+		ComplexFft bandFft;
+		int bandFirstBin = 0;
+		std::vector<const float*> bandRealFrames;
+		std::vector<const float*> bandImagFrames;
+
+		// DPSS tapers for multitaper mode, and the (N, NW) they were computed for.
+		std::vector<std::vector<float>> tapers;
+		int taperLength = 0;
+		float taperTimeHalfBandwidth = 0;
+
+		// Wavelet mode only; replaces the frames and FFTs.
+		MorletCwt cwt;
+
+		// Decimation keeps this many standard deviations of the highest wavelet's
+		// spectrum above its centre frequency.
+		static constexpr float MORLET_TAIL_SIGMAS = 4;
+
+		// One history and Welch average per channel.
+		std::vector<std::unique_ptr<SpectrogramHistory>> spectrograms;
+		std::vector<std::unique_ptr<WelchAccumulator>> welchAccumulators;
+		int freqsPerSpectrogramColumn = 0;
+		std::vector<double> rowFrequencies;
+
+		// Turns FFT magnitudes of the windowed input, in microvolts, into a
+		// one-sided amplitude spectral density in V/sqrt(Hz):
+		// sqrt(2 / (fs * sum of w^2)) / 10^6 at the decimated rate fs. Dividing
+		// out the window's energy keeps the noise floor independent of the
+		// window function, and matches the scaling of the wavelet transform.
+		float densityScaling = 1;
+
+		/** Appends numFrames columns to every history from the given frames,
+		laid out as by StftFrames::getFrames(). */
+		void calcSpectrograms(const float* const* frames, int numFrames);
+
+		/** Appends the oldest column that cwt has ready to every history. */
+		void calcWaveletColumns();
+
+		/** Feeds the first numColumns columns of every channel written through
+		fftOutputs to the Welch averages and publishes them, oldest first.
+		Column i starts i steps after the one that starts decimated sample
+		firstDecimated since the last restart. */
+		void publishColumns(int numColumns, int64_t firstDecimated);
+
+		/** Restarts the filters and frames at the next sample to be read. */
+		void restartStreams();
+
+		/** Moves past the anchors up to the next sample to be read, restarting
+		the streams if there are any.
+
+		@returns the number of samples that can be read before the next anchor.
+		*/
+		int64_t applyAnchors();
+
+		/** Resamples the history of previous into the histories; see the constructor. */
+		void carryOverHistory(const SpectrogramPipeline& previous);
+
+		/** Converts a column of magnitudes written through getNextColumn() to
+		the unit of the histories, and appends it to the given one. */
+		void finishColumn(SpectrogramHistory& history, float* column, const ColumnInfo& info);
+	};
+}
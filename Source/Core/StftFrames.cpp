@@ -0,0 +1,71 @@
+#include <algorithm>
+
+#include "StftFrames.h"
+
+using namespace SpectrogramViewer;
+
+void StftFrames::prepare(int numChannels_, int windowLength_, int hopLength_, int maxFrames_)
+{
+	numChannels = numChannels_;
+	windowLength = windowLength_;
+	hopLength = hopLength_;
+	maxFrames = std::max(1, maxFrames_);
+	ringLength = windowLength + (maxFrames - 1) * hopLength;
+
+	rings.assign(numChannels * 2 * ringLength, 0);
+	frames.resize(maxFrames * numChannels);
+	clear();
+}
+
+void StftFrames::clear()
+{
+	std::fill(rings.begin(), rings.end(), 0.f);
+	writeIndex = 0;
+	samplesUntilFrame = hopLength;
+	numFrames = 0;
+}
+
+int StftFrames::append(const float* const* in, int numSamples)
+{
+	int numConsumed = 0;
+
+	while (numFrames < maxFrames && numConsumed < numSamples)
+	{
+		// Copy up to the end of the ring, and again into its mirror.
+		int chunk = std::min({ samplesUntilFrame, ringLength - writeIndex, numSamples - numConsumed });
+
+		for (int c = 0; c < numChannels; c++)
+		{
+			auto source = in[c] + numConsumed;
+			auto ring = &rings[c * 2 * ringLength];
+			std::copy(source, source + chunk, ring + writeIndex);
+			std::copy(source, source + chunk, ring + writeIndex + ringLength);
+		}
+
+		samplesUntilFrame -= chunk;
+		numConsumed += chunk;
+		writeIndex += chunk;
+
+		if (writeIndex == ringLength)
+		{
+			writeIndex = 0;
+		}
+
+		if (samplesUntilFrame == 0)
+		{
+			// The frame ends just before writeIndex. In the mirrored ring it
+			// therefore starts windowLength samples before writeIndex + ringLength.
+			int start = writeIndex + ringLength - windowLength;
+
+			for (int c = 0; c < numChannels; c++)
+			{
+				frames[numFrames * numChannels + c] = &rings[c * 2 * ringLength + start];
+			}
+
+			numFrames++;
+			samplesUntilFrame = hopLength;
+		}
+	}
+
+	return numConsumed;
+}
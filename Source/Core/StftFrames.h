@@ -0,0 +1,67 @@
+#pragma once
+
+#include <vector>
+
+namespace SpectrogramViewer
+{
+	/** Cuts multi-channel input into overlapping STFT frames.
+
+	Keeps the most recent samples of every channel in a mirrored ring: each
+	sample is stored twice, one ring length apart, so every frame in the ring
+	is contiguous and can be handed to the FFT without unwrapping. A frame
+	completes every hopLength samples.
+
+	Completed frames are collected in a batch of up to maxFrames frames, so
+	that they can all be transformed in one call. The ring is long enough to
+	hold the whole batch (windowLength + (maxFrames - 1) * hopLength samples),
+	so the frames are never copied.
+	*/
+	class StftFrames
+	{
+	public:
+		/** Allocates the rings and clears them; the first frame completes after
+		hopLength samples, zero-padded on the left. */
+		void prepare(int numChannels, int windowLength, int hopLength, int maxFrames = 1);
+
+		int getWindowLength() const { return windowLength; }
+		int getHopLength() const { return hopLength; }
+		int getMaxFrames() const { return maxFrames; }
+
+		/** Appends up to numSamples samples of every channel, stopping early
+		if the batch fills up. Returns the number of samples consumed. */
+		int append(const float* const* in, int numSamples);
+
+		/** Returns the number of completed frames in the batch. */
+		int getNumFrames() const { return numFrames; }
+
+		bool isBatchFull() const { return numFrames == maxFrames; }
+
+		/** Returns getNumFrames() * numChannels pointers to the windowLength
+		samples of each completed frame, oldest frame first: channel c of frame
+		f is at index f * numChannels + c. Valid until clearFrames() or clear(). */
+		const float* const* getFrames() const { return frames.data(); }
+
+		/** Empties the batch, once its frames have been used. */
+		void clearFrames() { numFrames = 0; }
+
+		/** Zeroes the rings, empties the batch and restarts the hop, e.g. after
+		input was dropped. */
+		void clear();
+
+	private:
+		int numChannels = 0;
+		int windowLength = 0;
+		int hopLength = 0;
+		int maxFrames = 1;
+
+		// Per channel: 2 * ringLength samples, sample n at n % ringLength and
+		// again at n % ringLength + ringLength.
+		int ringLength = 0;
+		std::vector<float> rings;
+		int writeIndex = 0;
+		int samplesUntilFrame = 0;
+
+		std::vector<const float*> frames;
+		int numFrames = 0;
+	};
+}
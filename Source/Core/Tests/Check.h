@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdio>
+
+namespace SpectrogramViewer
+{
+	/** Number of failed CHECK()s so far; a test's main() returns nonzero if any. */
+	inline int& getNumFailedChecks()
+	{
+		static int numFailedChecks = 0;
+		return numFailedChecks;
+	}
+}
+
+/** Reports the condition and where it is if it doesn't hold, and carries on. */
+#define CHECK(condition) \
+	do \
+	{ \
+		if (!(condition)) \
+		{ \
+			std::printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+			SpectrogramViewer::getNumFailedChecks()++; \
+		} \
+	} while (false)
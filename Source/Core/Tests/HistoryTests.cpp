@@ -0,0 +1,231 @@
+// SpectrogramHistory::copyNewColumnsFrom(): the reader's copy must only ever
+// hold whole columns that the writer published, or no data.
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+
+#include "Check.h"
+#include "SpectrogramHistory.h"
+
+using namespace SpectrogramViewer;
+
+namespace
+{
+	/** Appends a column whose every row, and firstSample, is its sequence number. */
+	void writeColumn(SpectrogramHistory& history, int64_t sequenceNumber)
+	{
+		auto column = history.getNextColumn();
+		std::fill(column, column + history.getNumRows(), float(sequenceNumber));
+
+		ColumnInfo info;
+		info.firstSample = sequenceNumber;
+		history.finishColumn(info);
+	}
+
+	/** Returns true if every row of the column at the given age holds
+	expected, and its info says so too. */
+	bool holdsColumn(const SpectrogramHistory& history, int age, int64_t expected)
+	{
+		auto column = history.getColumn(age);
+
+		for (int r = 0; r < history.getNumRows(); r++)
+		{
+			if (column[r] != float(expected))
+			{
+				return false;
+			}
+		}
+
+		return history.getColumnInfo(age).firstSample == expected;
+	}
+
+	/** Returns true if the column at the given age is no data. */
+	bool isEmptyColumn(const SpectrogramHistory& history, int age)
+	{
+		auto column = history.getColumn(age);
+
+		for (int r = 0; r < history.getNumRows(); r++)
+		{
+			if (!std::isnan(column[r]))
+			{
+				return false;
+			}
+		}
+
+		return history.getColumnInfo(age).firstSample == -1;
+	}
+
+	void testCopiesOnlyNewColumns()
+	{
+		SpectrogramHistory source;
+		SpectrogramHistory copy;
+		source.resize(8, 3);
+
+		for (int i = 0; i < 3; i++)
+		{
+			writeColumn(source, i);
+		}
+
+		CHECK(copy.copyNewColumnsFrom(source) == 3);
+		CHECK(copy.getNumColumns() == 8 && copy.getNumRows() == 3);
+		CHECK(copy.getNumColumnsWritten() == 3);
+
+		writeColumn(source, 3);
+		CHECK(copy.copyNewColumnsFrom(source) == 1);
+		CHECK(copy.copyNewColumnsFrom(source) == 0);
+
+		// The writer is between columns, so only its next slot, which holds
+		// nothing yet, is suspect.
+		for (int i = 0; i < 4; i++)
+		{
+			CHECK(holdsColumn(copy, 4 + i, i));
+		}
+	}
+
+	void testOverrunReplacesEverything()
+	{
+		SpectrogramHistory source;
+		SpectrogramHistory copy;
+		source.resize(8, 3);
+
+		writeColumn(source, 0);
+		copy.copyNewColumnsFrom(source);
+
+		// The writer laps the reader several times over.
+		for (int i = 1; i < 30; i++)
+		{
+			writeColumn(source, i);
+		}
+
+		CHECK(copy.copyNewColumnsFrom(source) == 8);
+		CHECK(copy.getNumColumnsWritten() == 30);
+
+		// Column 22 shares its slot with the one the writer fills next, so it
+		// may have been torn and is dropped; 23 to 29 survive.
+		CHECK(isEmptyColumn(copy, 0));
+
+		for (int age = 1; age < 8; age++)
+		{
+			CHECK(holdsColumn(copy, age, 22 + age));
+		}
+	}
+
+	void testColumnsAheadAreDropped()
+	{
+		// A writer that fills 2 columns ahead may be writing into the slots of
+		// the 3 oldest columns at any time.
+		SpectrogramHistory source;
+		SpectrogramHistory copy;
+		source.resize(8, 3, 2);
+
+		for (int i = 0; i < 20; i++)
+		{
+			writeColumn(source, i);
+		}
+
+		CHECK(copy.copyNewColumnsFrom(source) == 8);
+
+		for (int age = 0; age < 3; age++)
+		{
+			CHECK(isEmptyColumn(copy, age));
+		}
+
+		for (int age = 3; age < 8; age++)
+		{
+			CHECK(holdsColumn(copy, age, 12 + age));
+		}
+	}
+
+	void testRestartsWithTheSource()
+	{
+		SpectrogramHistory source;
+		SpectrogramHistory copy;
+		source.resize(8, 3);
+
+		for (int i = 0; i < 5; i++)
+		{
+			writeColumn(source, i);
+		}
+
+		copy.copyNewColumnsFrom(source);
+
+		// Resetting the source puts it behind the copy, which starts over.
+		source.resize(8, 3);
+		writeColumn(source, 100);
+		CHECK(copy.copyNewColumnsFrom(source) == 1);
+		CHECK(copy.getNumColumnsWritten() == 1);
+		CHECK(holdsColumn(copy, 7, 100));
+		CHECK(isEmptyColumn(copy, 0));
+
+		// So does resizing it.
+		source.resize(4, 6);
+		writeColumn(source, 200);
+		CHECK(copy.copyNewColumnsFrom(source) == 1);
+		CHECK(copy.getNumColumns() == 4 && copy.getNumRows() == 6);
+		CHECK(holdsColumn(copy, 3, 200));
+	}
+
+	void testConcurrentWriterNeverTearsColumns()
+	{
+		// A small ring and a fast writer, so that the reader is lapped often.
+		SpectrogramHistory source;
+		source.resize(4, 256, 1);
+		std::atomic<bool> done { false };
+		const int64_t numColumns = 200000;
+
+		std::thread writer([&]
+		{
+			std::fill(source.getNextColumn(), source.getNextColumn() + source.getNumRows(), 0.f);
+
+			for (int64_t i = 0; i < numColumns; i++)
+			{
+				// Fill one column ahead before finishing the current one.
+				auto next = source.getNextColumn(1);
+				std::fill(next, next + source.getNumRows(), float(i + 1));
+
+				ColumnInfo info;
+				info.firstSample = i;
+				source.finishColumn(info);
+			}
+
+			done = true;
+		});
+
+		SpectrogramHistory copy;
+		int64_t numTorn = 0;
+
+		while (!done)
+		{
+			if (copy.copyNewColumnsFrom(source) == 0)
+			{
+				continue;
+			}
+
+			for (int age = 0; age < copy.getNumColumns(); age++)
+			{
+				auto& info = copy.getColumnInfo(age);
+
+				if (info.firstSample >= 0 && !holdsColumn(copy, age, info.firstSample) && !isEmptyColumn(copy, age))
+				{
+					numTorn++;
+				}
+			}
+		}
+
+		writer.join();
+		CHECK(numTorn == 0);
+	}
+}
+
+int main()
+{
+	testCopiesOnlyNewColumns();
+	testOverrunReplacesEverything();
+	testColumnsAheadAreDropped();
+	testRestartsWithTheSource();
+	testConcurrentWriterNeverTearsColumns();
+
+	return getNumFailedChecks() != 0;
+}
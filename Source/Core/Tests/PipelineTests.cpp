@@ -0,0 +1,192 @@
+// Runs signals through whole pipelines, single-threaded: the audio and worker
+// halves simply take turns.
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <random>
+#include <vector>
+
+#include "Check.h"
+#include "SpectrogramPipeline.h"
+
+using namespace SpectrogramViewer;
+
+namespace
+{
+	const double SAMPLE_RATE = 30000;
+	const int BUFFER_SIZE = 1024;
+	const double pi = 3.14159265358979323846;
+
+	// Long enough for the wavelets of the lowest rows to produce columns.
+	const double SIGNAL_LENGTH_SEC = 10;
+
+	/** Writes the given number of seconds of signal(sample number), in
+	microvolts, to a one-channel pipeline and processes it buffer by buffer. */
+	void feed(SpectrogramPipeline& pipeline, double seconds, const std::function<float(int64_t)>& signal)
+	{
+		std::vector<float> buffer(BUFFER_SIZE);
+		const float* inputs[] = { buffer.data() };
+		int64_t numSamples = int64_t(seconds * SAMPLE_RATE);
+
+		for (int64_t first = 0; first < numSamples; first += BUFFER_SIZE)
+		{
+			for (int i = 0; i < BUFFER_SIZE; i++)
+			{
+				buffer[i] = signal(first + i);
+			}
+
+			CHECK(pipeline.write(inputs, BUFFER_SIZE, first) == BUFFER_SIZE);
+			pipeline.processQueuedSamples(false);
+		}
+	}
+
+	/** Checks that a tone at the frequency of one of the rows peaks in that row,
+	or with log-spaced rows, in a neighbouring one. fractionOfRows picks the
+	row; on a log axis, rows narrower than a linear bin can't be resolved.
+
+	With linear rows and a Hann window, also checks that the neighbouring
+	rows are at half the level, which only holds if the tone is right on a
+	bin, i.e. if the row frequencies are those of the bins. */
+	void checkToneRow(const char* mode, SpectrogramSettings settings, double fractionOfRows)
+	{
+		settings.decibelOutput = false;
+		SpectrogramPipeline pipeline(settings, { 0 }, SAMPLE_RATE);
+
+		auto& rows = pipeline.getRowFrequencies();
+		int toneRow = int(fractionOfRows * (rows.size() - 1));
+		double toneHz = rows[toneRow];
+
+		feed(pipeline, SIGNAL_LENGTH_SEC, [&](int64_t n) { return float(100 * std::sin(2 * pi * toneHz * n / SAMPLE_RATE)); });
+
+		auto& history = pipeline.getSpectrogram(0);
+		auto column = history.getColumn(history.getNumColumns() - 1);
+		CHECK(std::none_of(column, column + history.getNumRows(), [](float value) { return std::isnan(value); }));
+		int peakRow = int(std::max_element(column, column + history.getNumRows()) - column);
+		int tolerance = settings.isLogFrequencyAxis() ? 1 : 0;
+
+		if (std::abs(peakRow - toneRow) > tolerance)
+		{
+			std::printf("%s: a %.2f Hz tone peaks in row %d (%.2f Hz), not %d\n",
+				mode, toneHz, peakRow, rows[peakRow], toneRow);
+		}
+
+		CHECK(std::abs(peakRow - toneRow) <= tolerance);
+
+		bool onBin = settings.windowFunction == WINDOW_HANN
+			&& !settings.isLogFrequencyAxis() && !settings.isMultitaper()
+			&& toneRow > 0 && toneRow < history.getNumRows() - 1;
+
+		if (onBin)
+		{
+			double below = column[toneRow - 1] / column[toneRow];
+			double above = column[toneRow + 1] / column[toneRow];
+
+			if (std::abs(below - 0.5) > 0.03 || std::abs(above - 0.5) > 0.03)
+			{
+				std::printf("%s: the rows around a %.2f Hz tone are at %.3f and %.3f of it, not 0.5\n",
+					mode, toneHz, below, above);
+			}
+
+			CHECK(std::abs(below - 0.5) <= 0.03 && std::abs(above - 0.5) <= 0.03);
+		}
+	}
+
+	/** Checks that white noise of 1 uV/sqrt(Hz) reads 1e-6 V/sqrt(Hz) on
+	average, over the middle half of the rows. */
+	void checkNoiseDensity(const char* mode, SpectrogramSettings settings)
+	{
+		settings.decibelOutput = false;
+		SpectrogramPipeline pipeline(settings, { 0 }, SAMPLE_RATE);
+
+		// A one-sided density D is a variance of D^2 fs / 2.
+		std::mt19937 random(1);
+		std::normal_distribution<float> noise(0, float(std::sqrt(SAMPLE_RATE / 2)));
+		feed(pipeline, SIGNAL_LENGTH_SEC, [&](int64_t) { return noise(random); });
+
+		auto& history = pipeline.getSpectrogram(0);
+		int numRows = history.getNumRows();
+		double sumOfSquares = 0;
+		int numValues = 0;
+
+		for (int c = history.getNumColumns() - 20; c < history.getNumColumns(); c++)
+		{
+			auto column = history.getColumn(c);
+
+			for (int r = numRows / 4; r < numRows * 3 / 4; r++)
+			{
+				sumOfSquares += column[r] * column[r];
+				numValues++;
+			}
+		}
+
+		double density = std::sqrt(sumOfSquares / numValues);
+
+		if (std::abs(density / 1e-6 - 1) > 0.15)
+		{
+			std::printf("%s: white noise of 1e-6 V/sqrt(Hz) reads %g\n", mode, density);
+		}
+
+		CHECK(std::abs(density / 1e-6 - 1) <= 0.15);
+	}
+}
+
+int main()
+{
+	SpectrogramSettings fft;
+
+	// With 1 Hz bins, the log rows tested are at least a bin wide.
+	SpectrogramSettings log = fft;
+	log.logFrequencyAxis = true;
+	log.windowLengthSec = 1;
+
+	SpectrogramSettings band = fft;
+	band.minShownFrequency = 100;
+	band.maxShownFrequency = 200;
+
+	// Windows that are not a whole number of nominal bins after decimation:
+	// 30 ms is 22 samples, and the bins are 34.09 Hz apart rather than 33.33;
+	// in the band, 47 ms is 8 samples, and 20.83 Hz bins rather than 21.28.
+	SpectrogramSettings shortFft = fft;
+	shortFft.windowLengthSec = 0.03f;
+
+	SpectrogramSettings shortBand = band;
+	shortBand.minShownFrequency = 900;
+	shortBand.maxShownFrequency = 1000;
+	shortBand.windowLengthSec = 0.047f;
+
+	// A 2 ms step over a 1 s window is 2 samples of 750 after decimation,
+	// where updating a sliding DFT is cheaper than an FFT of every frame.
+	SpectrogramSettings slidingDft = fft;
+	slidingDft.windowLengthSec = 1;
+	slidingDft.stepLengthSec = 0.002f;
+	CHECK(SpectrogramPipeline(slidingDft, { 0 }, SAMPLE_RATE).usesSlidingDft());
+	CHECK(!SpectrogramPipeline(fft, { 0 }, SAMPLE_RATE).usesSlidingDft());
+
+	SpectrogramSettings multitaper = fft;
+	multitaper.numTapers = 5;
+
+	SpectrogramSettings wavelet = fft;
+	wavelet.waveletCycles = 6;
+
+	for (double fraction : { 0.5, 0.85 })
+	{
+		checkToneRow("FFT", fft, fraction);
+		checkToneRow("log", log, fraction);
+		checkToneRow("band", band, fraction);
+		checkToneRow("short FFT", shortFft, fraction);
+		checkToneRow("short band", shortBand, fraction);
+		checkToneRow("sliding DFT", slidingDft, fraction);
+		checkToneRow("multitaper", multitaper, fraction);
+		checkToneRow("wavelet", wavelet, fraction);
+	}
+
+	checkNoiseDensity("FFT", fft);
+	checkNoiseDensity("log", log);
+	checkNoiseDensity("band", band);
+	checkNoiseDensity("sliding DFT", slidingDft);
+	checkNoiseDensity("multitaper", multitaper);
+	checkNoiseDensity("wavelet", wavelet);
+
+	return getNumFailedChecks() != 0;
+}
@@ -0,0 +1,166 @@
+// Every SIMD variant of the kernels that this CPU runs must match the generic
+// one, for lengths that exercise both the vector loops and the tails.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "Check.h"
+#include "SimdKernels.h"
+
+using namespace SpectrogramViewer;
+
+namespace
+{
+	const int MAX_LENGTH = 100;
+
+	/** Returns true if the arrays agree to within tolerance, relative to the
+	larger magnitude, or absolute below 1. NaNs must match NaNs. */
+	bool agree(const std::vector<float>& expected, const std::vector<float>& actual, float tolerance)
+	{
+		for (size_t i = 0; i < expected.size(); i++)
+		{
+			if (std::isnan(expected[i]) || std::isnan(actual[i]))
+			{
+				if (std::isnan(expected[i]) != std::isnan(actual[i]))
+				{
+					return false;
+				}
+
+				continue;
+			}
+
+			float scale = std::max(1.f, std::max(std::abs(expected[i]), std::abs(actual[i])));
+
+			if (std::abs(expected[i] - actual[i]) > tolerance * scale)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	/** Returns true if the levels differ by at most one, where rounding in a
+	different order can put a value on the other side of a level boundary. */
+	template <typename Level>
+	bool agree(const std::vector<Level>& expected, const std::vector<Level>& actual)
+	{
+		for (size_t i = 0; i < expected.size(); i++)
+		{
+			if (std::abs(int(expected[i]) - int(actual[i])) > 1)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	void compareKernels(const SimdKernels& generic, const SimdKernels& simd)
+	{
+		std::mt19937 random(1);
+		std::uniform_real_distribution<float> values(-1000, 1000);
+		std::uniform_real_distribution<float> magnitudes(1e-8f, 1e3f);
+
+		for (int n = 0; n <= MAX_LENGTH; n++)
+		{
+			std::vector<float> complex(2 * n);
+			std::vector<float> real(n);
+			std::vector<float> window(n);
+
+			for (auto& value : complex)
+			{
+				value = values(random);
+			}
+
+			for (int i = 0; i < n; i++)
+			{
+				real[i] = magnitudes(random);
+				window[i] = values(random);
+			}
+
+			// Zeros, no data, and values beyond both ends of the level range.
+			if (n > 3)
+			{
+				complex[0] = complex[1] = 0;
+				real[0] = 0;
+				real[1] = NAN;
+				real[2] = 1e-30f;
+				real[3] = 1e30f;
+			}
+
+			std::vector<float> expected(n);
+			std::vector<float> actual(n);
+
+			generic.complexMagnitudes(complex.data(), expected.data(), n, 0.5f);
+			simd.complexMagnitudes(complex.data(), actual.data(), n, 0.5f);
+			CHECK(agree(expected, actual, 1e-6f));
+
+			generic.complexDecibels(complex.data(), expected.data(), n, 0.5f);
+			simd.complexDecibels(complex.data(), actual.data(), n, 0.5f);
+			CHECK(agree(expected, actual, 1e-5f));
+
+			std::fill(expected.begin(), expected.end(), 1.f);
+			std::fill(actual.begin(), actual.end(), 1.f);
+			generic.accumulateComplexPowers(complex.data(), expected.data(), n);
+			simd.accumulateComplexPowers(complex.data(), actual.data(), n);
+			CHECK(agree(expected, actual, 1e-6f));
+
+			generic.toDecibels(real.data(), expected.data(), n, 2.f, 20.f);
+			simd.toDecibels(real.data(), actual.data(), n, 2.f, 20.f);
+			CHECK(agree(expected, actual, 1e-5f));
+
+			generic.multiply(real.data(), window.data(), expected.data(), n);
+			simd.multiply(real.data(), window.data(), actual.data(), n);
+			CHECK(agree(expected, actual, 0));
+
+			// As the colour map uses them: 256 levels over 1e-7 to 1e-1, on
+			// magnitudes, and on values in dB.
+			std::vector<uint8_t> expectedLevels(n);
+			std::vector<uint8_t> actualLevels(n);
+			float levelsPerLog2 = 256 / 6.f * 0.30103f;
+			float levelOffset = 7 * 256 / 6.f;
+
+			generic.logQuantize(real.data(), expectedLevels.data(), n, levelsPerLog2, levelOffset, 255);
+			simd.logQuantize(real.data(), actualLevels.data(), n, levelsPerLog2, levelOffset, 255);
+			CHECK(agree(expectedLevels, actualLevels));
+
+			generic.quantize(window.data(), expectedLevels.data(), n, 0.2f, 128, 255);
+			simd.quantize(window.data(), actualLevels.data(), n, 0.2f, 128, 255);
+			CHECK(agree(expectedLevels, actualLevels));
+
+			std::vector<uint16_t> expectedLevels16(n);
+			std::vector<uint16_t> actualLevels16(n);
+			generic.quantize16(window.data(), expectedLevels16.data(), n, 50.f, 32768, 65535);
+			simd.quantize16(window.data(), actualLevels16.data(), n, 50.f, 32768, 65535);
+			CHECK(agree(expectedLevels16, actualLevels16));
+		}
+	}
+}
+
+int main()
+{
+	auto& generic = getSimdKernels(SIMD_GENERIC);
+	CHECK(generic.level == SIMD_GENERIC);
+
+	for (auto level : { SIMD_SSE2, SIMD_AVX2, SIMD_AVX512 })
+	{
+		if (level > getSupportedSimdLevel())
+		{
+			std::printf("%s: not supported here, skipped\n", getSimdLevelName(level));
+			continue;
+		}
+
+		auto& simd = getSimdKernels(level);
+		CHECK(simd.level == level);
+
+		int numFailedBefore = getNumFailedChecks();
+		compareKernels(generic, simd);
+		std::printf("%s: %s\n", getSimdLevelName(level), getNumFailedChecks() == numFailedBefore ? "ok" : "FAILED");
+	}
+
+	return getNumFailedChecks() != 0;
+}
@@ -0,0 +1,132 @@
+// SlidingDft must give the magnitudes that RealFft gives for the same frames
+// under every window it supports, including after a reset.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "Check.h"
+#include "RealFft.h"
+#include "SlidingDft.h"
+#include "StftFrames.h"
+
+using namespace SpectrogramViewer;
+
+namespace
+{
+	const int NUM_CHANNELS = 3;
+	const int SIGNAL_LENGTH = 4000;
+
+	// Input is appended in blocks of this many samples, so that batches
+	// hold a varying number of frames.
+	const int BLOCK_SIZE = 37;
+
+	/** Feeds the same noise and tones to both engines, restarting both halfway
+	through, and checks that every bin agrees to within tolerance of the
+	largest one. */
+	void checkAgainstFft(WindowFunction window, int length, int hopLength, int numBins)
+	{
+		StftFrames frames;
+		frames.prepare(NUM_CHANNELS, length, hopLength, 4);
+
+		SlidingDft slidingDft;
+		slidingDft.prepare(NUM_CHANNELS, length, hopLength, numBins, window);
+
+		RealFft fft;
+		fft.prepare(length);
+		fft.setWindow(makeWindow(window, length));
+
+		std::mt19937 random(1);
+		std::normal_distribution<float> noise(0, 1);
+		std::vector<float> signals(NUM_CHANNELS * SIGNAL_LENGTH);
+
+		for (int c = 0; c < NUM_CHANNELS; c++)
+		{
+			for (int n = 0; n < SIGNAL_LENGTH; n++)
+			{
+				signals[c * SIGNAL_LENGTH + n] = 100 * std::sin(0.37f * (c + 1) * n) + noise(random);
+			}
+		}
+
+		int maxTransforms = frames.getMaxFrames() * NUM_CHANNELS;
+		std::vector<float> expected(maxTransforms * numBins);
+		std::vector<float> actual(expected.size());
+		std::vector<float*> expectedColumns(maxTransforms);
+		std::vector<float*> actualColumns(maxTransforms);
+
+		for (int i = 0; i < maxTransforms; i++)
+		{
+			expectedColumns[i] = &expected[i * numBins];
+			actualColumns[i] = &actual[i * numBins];
+		}
+
+		std::vector<const float*> in(NUM_CHANNELS);
+		float maxMagnitude = 0;
+		float maxError = 0;
+
+		for (int position = 0; position < SIGNAL_LENGTH;)
+		{
+			if (position == SIGNAL_LENGTH / 2)
+			{
+				frames.clear();
+				slidingDft.reset();
+			}
+
+			for (int c = 0; c < NUM_CHANNELS; c++)
+			{
+				in[c] = &signals[c * SIGNAL_LENGTH + position];
+			}
+
+			// Blocks stop at the restart.
+			int end = (position < SIGNAL_LENGTH / 2) ? SIGNAL_LENGTH / 2 : SIGNAL_LENGTH;
+			position += frames.append(in.data(), std::min(BLOCK_SIZE, end - position));
+
+			int numFrames = frames.getNumFrames();
+
+			if (numFrames == 0)
+			{
+				continue;
+			}
+
+			fft.calcMagnitudes(frames.getFrames(), expectedColumns.data(), numFrames * NUM_CHANNELS, numBins, 1.f);
+			slidingDft.calcMagnitudes(frames.getFrames(), actualColumns.data(), numFrames, 1.f);
+			frames.clearFrames();
+
+			for (int i = 0; i < numFrames * NUM_CHANNELS * numBins; i++)
+			{
+				maxMagnitude = std::max(maxMagnitude, expected[i]);
+				maxError = std::max(maxError, std::abs(actual[i] - expected[i]));
+			}
+		}
+
+		if (!(maxError <= 1e-5f * maxMagnitude))
+		{
+			std::printf("window %d, length %d, hop %d, %d bins: off by %g of the peak\n",
+				int(window), length, hopLength, numBins, maxError / maxMagnitude);
+		}
+
+		CHECK(maxError <= 1e-5f * maxMagnitude);
+	}
+}
+
+int main()
+{
+	CHECK(!SlidingDft::supportsWindow(WINDOW_KAISER));
+
+	for (auto window : { WINDOW_RECTANGULAR, WINDOW_HANN, WINDOW_HAMMING, WINDOW_BLACKMAN_HARRIS })
+	{
+		CHECK(SlidingDft::supportsWindow(window));
+
+		// Odd and even lengths, some bins or all of them up to Nyquist, and a
+		// window shorter than the widest cosine sum.
+		checkAgainstFft(window, 64, 1, 33);
+		checkAgainstFft(window, 75, 3, 20);
+		checkAgainstFft(window, 750, 2, 301);
+		checkAgainstFft(window, 750, 16, 376);
+		checkAgainstFft(window, 5, 2, 3);
+	}
+
+	return getNumFailedChecks() != 0;
+}
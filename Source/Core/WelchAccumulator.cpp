@@ -0,0 +1,60 @@
+#include <algorithm>
+
+#include "WelchAccumulator.h"
+
+using namespace SpectrogramViewer;
+
+void WelchAccumulator::resize(int numSegments_, int numBins_)
+{
+	numSegments = std::max(1, numSegments_);
+	numBins = numBins_;
+
+	powers.assign(numSegments * numBins, 0);
+	sum.assign(numBins, 0);
+	head = 0;
+	numFilled = 0;
+
+	averages.resize(NUM_PUBLISHED_AVERAGES, numBins);
+}
+
+void WelchAccumulator::addColumn(const float* magnitudes)
+{
+	float* slot = &powers[head * numBins];
+
+	for (int i = 0; i < numBins; i++)
+	{
+		float power = magnitudes[i] * magnitudes[i];
+		sum[i] += double(power) - slot[i];
+		slot[i] = power;
+	}
+
+	numFilled = std::min(numFilled + 1, numSegments);
+	head++;
+
+	if (head == numSegments)
+	{
+		head = 0;
+
+		// Start the running sum over from the stored powers once per lap.
+		std::fill(sum.begin(), sum.end(), 0.0);
+
+		for (int segment = 0; segment < numSegments; segment++)
+		{
+			const float* column = &powers[segment * numBins];
+
+			for (int i = 0; i < numBins; i++)
+			{
+				sum[i] += column[i];
+			}
+		}
+	}
+
+	float* average = averages.getNextColumn();
+
+	for (int i = 0; i < numBins; i++)
+	{
+		average[i] = float(sum[i] / numFilled);
+	}
+
+	averages.finishColumn();
+}
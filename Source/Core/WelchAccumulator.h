@@ -0,0 +1,58 @@
+#pragma once
+
+#include <vector>
+
+#include "SpectrogramHistory.h"
+
+namespace SpectrogramViewer
+{
+	/** Welch-averaged power spectral density over the most recent spectrogram columns.
+
+	Keeps the power of the last numSegments columns in a ring and a running sum
+	of them: each new column is added and the one leaving the window subtracted,
+	so an update costs O(bins) however many segments are averaged. The sum is
+	kept in double precision and recomputed from the ring each time the ring
+	wraps, so rounding errors don't build up over a long acquisition.
+
+	Every average is published as a column of getAverages(), which readers on
+	other threads copy with SpectrogramHistory::copyNewColumnsFrom() and read
+	the newest column of.
+	*/
+	class WelchAccumulator
+	{
+	public:
+		/** Number of published averages kept, so that a reader rarely catches the
+		writer overwriting the one it is copying. */
+		static const int NUM_PUBLISHED_AVERAGES = 4;
+
+		/** Sets the number of segments to average and the number of bins, and
+		clears the accumulated columns. */
+		void resize(int numSegments, int numBins);
+
+		int getNumSegments() const { return numSegments; }
+		int getNumBins() const { return numBins; }
+
+		/** Returns how many columns the current average is over; less than
+		getNumSegments() until that many columns have been added. */
+		int getNumSegmentsAveraged() const { return numFilled; }
+
+		/** Adds a column of magnitudes (as in the spectrogram history), drops the
+		oldest one if the window is full, and publishes the new average power. */
+		void addColumn(const float* magnitudes);
+
+		/** Published average power per bin, one column per update. */
+		const SpectrogramHistory& getAverages() const { return averages; }
+
+	private:
+		int numSegments = 0;
+		int numBins = 0;
+
+		// Power of the last numSegments columns; the next column goes into slot head.
+		std::vector<float> powers;
+		int head = 0;
+		int numFilled = 0;
+
+		std::vector<double> sum;
+		SpectrogramHistory averages;
+	};
+}
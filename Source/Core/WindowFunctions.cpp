@@ -0,0 +1,317 @@
+#include <algorithm>
+#include <cmath>
+
+#include "WindowFunctions.h"
+
+using namespace SpectrogramViewer;
+
+namespace
+{
+	const double pi = 3.14159265358979323846;
+
+	/** Zeroth-order modified Bessel function of the first kind. */
+	double besselI0(double x)
+	{
+		double sum = 1;
+		double term = 1;
+		double halfX = x / 2;
+
+		for (int k = 1; k < 50; k++)
+		{
+			term *= (halfX / k) * (halfX / k);
+			sum += term;
+
+			if (term < sum * 1e-12)
+			{
+				break;
+			}
+		}
+
+		return sum;
+	}
+
+	/** Number of eigenvalues below x of the symmetric tridiagonal matrix with the
+	given diagonal and off-diagonal (offDiagonal[i] couples rows i - 1 and i). */
+	int countEigenvaluesBelow(const std::vector<double>& diagonal, const std::vector<double>& offDiagonal, double x)
+	{
+		int count = 0;
+		double q = 1;
+
+		for (int i = 0; i < (int)diagonal.size(); i++)
+		{
+			double coupling = (i > 0) ? offDiagonal[i] * offDiagonal[i] / q : 0;
+			q = diagonal[i] - x - coupling;
+
+			if (q == 0)
+			{
+				q = 1e-300;
+			}
+
+			if (q < 0)
+			{
+				count++;
+			}
+		}
+
+		return count;
+	}
+
+	/** Solves (T - shift I) x = b in place for the tridiagonal T, with partial pivoting. */
+	void solveShiftedTridiagonal(
+		const std::vector<double>& diagonal,
+		const std::vector<double>& offDiagonal,
+		double shift,
+		std::vector<double>& b)
+	{
+		int n = int(diagonal.size());
+
+		// Row i of the factored system holds u[i] x[i] + v[i] x[i + 1] + w[i] x[i + 2].
+		std::vector<double> u(n), v(n, 0.0), w(n, 0.0);
+		std::vector<double> lower(n, 0.0);
+		std::vector<char> swapped(n, 0);
+
+		double rowDiag = diagonal[0] - shift;
+		double rowUpper = (n > 1) ? offDiagonal[1] : 0;
+
+		for (int i = 0; i < n - 1; i++)
+		{
+			double below = offDiagonal[i + 1];
+			double belowDiag = diagonal[i + 1] - shift;
+			double belowUpper = (i + 2 < n) ? offDiagonal[i + 2] : 0;
+
+			if (std::abs(rowDiag) >= std::abs(below))
+			{
+				double factor = (rowDiag != 0) ? below / rowDiag : 0;
+				u[i] = rowDiag;
+				v[i] = rowUpper;
+				w[i] = 0;
+				lower[i] = factor;
+				rowDiag = belowDiag - factor * rowUpper;
+				rowUpper = belowUpper;
+			}
+			else
+			{
+				double factor = rowDiag / below;
+				u[i] = below;
+				v[i] = belowDiag;
+				w[i] = belowUpper;
+				lower[i] = factor;
+				swapped[i] = 1;
+				rowDiag = rowUpper - factor * belowDiag;
+				rowUpper = -factor * belowUpper;
+			}
+		}
+
+		u[n - 1] = (rowDiag != 0) ? rowDiag : 1e-300;
+
+		for (int i = 0; i < n - 1; i++)
+		{
+			if (swapped[i])
+			{
+				std::swap(b[i], b[i + 1]);
+			}
+
+			b[i + 1] -= lower[i] * b[i];
+		}
+
+		for (int i = n - 1; i >= 0; i--)
+		{
+			double sum = b[i];
+
+			if (i + 1 < n)
+			{
+				sum -= v[i] * b[i + 1];
+			}
+
+			if (i + 2 < n)
+			{
+				sum -= w[i] * b[i + 2];
+			}
+
+			b[i] = sum / (u[i] != 0 ? u[i] : 1e-300);
+		}
+	}
+}
+
+bool SpectrogramViewer::getCosineSumCoefficients(WindowFunction function, double coefficients[4])
+{
+	double a[4] = { 1, 0, 0, 0 };
+
+	switch (function)
+	{
+	case WINDOW_RECTANGULAR:
+		break;
+	case WINDOW_HANN:
+		a[0] = 0.5;
+		a[1] = 0.5;
+		break;
+	case WINDOW_HAMMING:
+		a[0] = 0.54;
+		a[1] = 0.46;
+		break;
+	case WINDOW_BLACKMAN_HARRIS:
+		a[0] = 0.35875;
+		a[1] = 0.48829;
+		a[2] = 0.14128;
+		a[3] = 0.01168;
+		break;
+	default:
+		return false;
+	}
+
+	std::copy(a, a + 4, coefficients);
+	return true;
+}
+
+std::vector<float> SpectrogramViewer::makeWindow(WindowFunction function, int length, float kaiserBeta)
+{
+	std::vector<float> window(length, 1.f);
+	double a[4];
+
+	if (getCosineSumCoefficients(function, a))
+	{
+		for (int n = 0; n < length; n++)
+		{
+			double x = 2 * pi * n / length;
+			window[n] = a[0] - a[1] * std::cos(x) + a[2] * std::cos(2 * x) - a[3] * std::cos(3 * x);
+		}
+	}
+	else if (function == WINDOW_KAISER)
+	{
+		for (int n = 0; n < length; n++)
+		{
+			double ratio = 2.0 * n / length - 1;
+			window[n] = besselI0(kaiserBeta * std::sqrt(1 - ratio * ratio)) / besselI0(kaiserBeta);
+		}
+	}
+
+	return window;
+}
+
+std::vector<float> SpectrogramViewer::makeLowpassFilter(int numTaps, double cutoff, double kaiserBeta)
+{
+	std::vector<double> taps(numTaps);
+	double center = (numTaps - 1) / 2.0;
+	double sum = 0;
+
+	for (int n = 0; n < numTaps; n++)
+	{
+		double t = n - center;
+		double sinc = (t == 0) ? 2 * cutoff : std::sin(2 * pi * cutoff * t) / (pi * t);
+		double ratio = (numTaps > 1) ? t / center : 0;
+		taps[n] = sinc * besselI0(kaiserBeta * std::sqrt(1 - ratio * ratio)) / besselI0(kaiserBeta);
+		sum += taps[n];
+	}
+
+	std::vector<float> normalizedTaps(numTaps);
+
+	for (int n = 0; n < numTaps; n++)
+	{
+		normalizedTaps[n] = taps[n] / sum;
+	}
+
+	return normalizedTaps;
+}
+
+std::vector<std::vector<float>> SpectrogramViewer::makeDpssTapers(int length, double timeHalfBandwidth, int numTapers)
+{
+	std::vector<std::vector<float>> tapers;
+	numTapers = std::min(numTapers, length);
+
+	// The tridiagonal matrix of Slepian (1978); its largest eigenvalues belong to
+	// the best concentrated sequences.
+	double cosBandwidth = std::cos(2 * pi * timeHalfBandwidth / length);
+	std::vector<double> diagonal(length), offDiagonal(length, 0.0);
+	double lowerBound = 0;
+	double upperBound = 0;
+
+	for (int n = 0; n < length; n++)
+	{
+		double half = (length - 1 - 2.0 * n) / 2;
+		diagonal[n] = half * half * cosBandwidth;
+
+		if (n > 0)
+		{
+			offDiagonal[n] = n * (length - n) / 2.0;
+		}
+	}
+
+	for (int n = 0; n < length; n++)
+	{
+		double radius = offDiagonal[n] + ((n + 1 < length) ? offDiagonal[n + 1] : 0);
+		lowerBound = std::min(lowerBound, diagonal[n] - radius);
+		upperBound = std::max(upperBound, diagonal[n] + radius);
+	}
+
+	for (int k = 0; k < numTapers; k++)
+	{
+		// Bisect for the k-th largest eigenvalue.
+		int index = length - 1 - k;
+		double low = lowerBound;
+		double high = upperBound;
+
+		for (int iteration = 0; iteration < 200 && high - low > 1e-13 * std::max(1.0, std::abs(high)); iteration++)
+		{
+			double middle = (low + high) / 2;
+
+			if (countEigenvaluesBelow(diagonal, offDiagonal, middle) > index)
+			{
+				high = middle;
+			}
+			else
+			{
+				low = middle;
+			}
+		}
+
+		double eigenvalue = (low + high) / 2;
+
+		// Inverse iteration, starting from a vector with the taper's symmetry.
+		std::vector<double> vector(length);
+
+		for (int n = 0; n < length; n++)
+		{
+			vector[n] = (k % 2 == 0) ? 1.0 : (length - 1 - 2.0 * n);
+		}
+
+		for (int iteration = 0; iteration < 3; iteration++)
+		{
+			solveShiftedTridiagonal(diagonal, offDiagonal, eigenvalue, vector);
+
+			double norm = 0;
+
+			for (auto value : vector)
+			{
+				norm += value * value;
+			}
+
+			norm = std::sqrt(norm);
+
+			for (auto& value : vector)
+			{
+				value /= norm;
+			}
+		}
+
+		// Same sign convention as Percival and Walden: even tapers sum to a
+		// positive value, odd tapers start with a positive slope.
+		double sum = 0;
+		double slope = 0;
+
+		for (int n = 0; n < length; n++)
+		{
+			sum += vector[n];
+			slope += (length - 1 - 2.0 * n) * vector[n];
+		}
+
+		double sign = ((k % 2 == 0) ? sum : slope) < 0 ? -1 : 1;
+		tapers.emplace_back(length);
+
+		for (int n = 0; n < length; n++)
+		{
+			tapers.back()[n] = float(sign * vector[n]);
+		}
+	}
+
+	return tapers;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <vector>
+
+namespace SpectrogramViewer
+{
+	/** Window functions applied to each STFT frame. The values are stored as
+	the PARAM_WINDOW_FUNCTION parameter, so don't renumber them. */
+	enum WindowFunction
+	{
+		WINDOW_RECTANGULAR = 0,
+		WINDOW_HANN = 1,
+		WINDOW_HAMMING = 2,
+		WINDOW_BLACKMAN_HARRIS = 3,
+		WINDOW_KAISER = 4
+	};
+
+	/** Returns the periodic (DFT-even) form of the window with the given length.
+
+	kaiserBeta is only used by WINDOW_KAISER.
+	*/
+	std::vector<float> makeWindow(WindowFunction function, int length, float kaiserBeta = 8.6f);
+
+	/** Gets the coefficients of a cosine-sum window, whose periodic form is
+	a0 - a1 cos(x) + a2 cos(2x) - a3 cos(3x) at x = 2 pi n / length.
+
+	@returns false if the window is not a cosine sum (WINDOW_KAISER).
+	*/
+	bool getCosineSumCoefficients(WindowFunction function, double coefficients[4]);
+
+	/** Designs a linear-phase lowpass FIR filter with numTaps taps by the
+	Kaiser-windowed sinc method. cutoff is relative to the sample rate (0..0.5);
+	the DC gain is 1.
+	*/
+	std::vector<float> makeLowpassFilter(int numTaps, double cutoff, double kaiserBeta);
+
+	/** Computes the first numTapers discrete prolate spheroidal (Slepian) sequences
+	of the given length and time-half-bandwidth product NW, for multitaper
+	estimation. Each taper has unit energy.
+
+	The tapers are eigenvectors of the tridiagonal matrix that commutes with the
+	concentration problem; the eigenvalues are found by bisection and the vectors
+	by inverse iteration, which takes O(length) per iteration.
+	*/
+	std::vector<std::vector<float>> makeDpssTapers(int length, double timeHalfBandwidth, int numTapers);
+}
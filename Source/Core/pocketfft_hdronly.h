@@ -1538,12 +1538,12 @@ namespace pocketfft
                 }
             }
 
-            template<bool fwd, typename T> void pass_all(T c[], T0 fct) const
+            template<bool fwd, typename T> void pass_all(T c[], T0 fct, T* buf) const
             {
                 if (length == 1) { c[0] *= fct; return; }
                 size_t l1 = 1;
-                arr<T> ch(length);
-                T* p1 = c, * p2 = ch.data();
+                arr<T> ch(buf ? 0 : length);
+                T* p1 = c, * p2 = buf ? buf : ch.data();
 
                 for (size_t k1 = 0; k1 < fact.size(); k1++)
                 {
@@ -1576,7 +1576,7 @@ namespace pocketfft
                 {
                     if (fct != 1.)
                         for (size_t i = 0; i < length; ++i)
-                            c[i] = ch[i] * fct;
+                            c[i] = p1[i] * fct;
                     else
                         std::copy_n(p1, length, c);
                 }
@@ -1587,9 +1587,11 @@ namespace pocketfft
             }
 
         public:
-            template<typename T> void exec(T c[], T0 fct, bool fwd) const
+            /* If buf is not null, it must hold at least length elements and is used
+               as the working array instead of allocating one on every call. */
+            template<typename T> void exec(T c[], T0 fct, bool fwd, T* buf = nullptr) const
             {
-                fwd ? pass_all<true>(c, fct) : pass_all<false>(c, fct);
+                fwd ? pass_all<true>(c, fct, buf) : pass_all<false>(c, fct, buf);
             }
 
         private:
@@ -2405,12 +2407,14 @@ namespace pocketfft
             }
 
         public:
-            template<typename T> void exec(T c[], T0 fct, bool r2hc) const
+            /* If buf is not null, it must hold at least length elements and is used
+               as the working array instead of allocating one on every call. */
+            template<typename T> void exec(T c[], T0 fct, bool r2hc, T* buf = nullptr) const
             {
                 if (length == 1) { c[0] *= fct; return; }
                 size_t nf = fact.size();
-                arr<T> ch(length);
-                T* p1 = c, * p2 = ch.data();
+                arr<T> ch(buf ? 0 : length);
+                T* p1 = c, * p2 = buf ? buf : ch.data();
 
                 if (r2hc)
                     for (size_t k1 = 0, l1 = length; k1 < nf; ++k1)
@@ -2679,6 +2683,14 @@ namespace pocketfft
                 packplan ? packplan->exec(c, fct, fwd) : blueplan->exec(c, fct, fwd);
             }
 
+            /* Same as exec(), but the FFTPACK path works in the caller-provided buf
+               (at least length() elements) instead of allocating. The Bluestein path
+               and factors above 11 still allocate. */
+            template<typename T> POCKETFFT_NOINLINE void exec(cmplx<T> c[], T0 fct, bool fwd, cmplx<T>* buf) const
+            {
+                packplan ? packplan->exec(c, fct, fwd, buf) : blueplan->exec(c, fct, fwd);
+            }
+
             size_t length() const { return len; }
         };
 
@@ -2718,6 +2730,18 @@ namespace pocketfft
                 packplan ? packplan->exec(c, fct, fwd) : blueplan->exec_r(c, fct, fwd);
             }
 
+            /* Same as exec(), but the FFTPACK path works in the caller-provided buf
+               (at least length() elements) instead of allocating. The Bluestein path
+               still allocates; use a length with small prime factors to avoid it. */
+            template<typename T> POCKETFFT_NOINLINE void exec(T c[], T0 fct, bool fwd, T* buf) const
+            {
+                packplan ? packplan->exec(c, fct, fwd, buf) : blueplan->exec_r(c, fct, fwd);
+            }
+
+            /* True if transforms of this length run without heap allocation when a
+               working buffer is passed to exec(). */
+            bool needs_no_allocation() const { return bool(packplan); }
+
             size_t length() const { return len; }
         };
 
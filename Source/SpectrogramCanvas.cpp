@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <cmath>
 #include <cstdio>
 
 #include "SpectrogramNode.h"
@@ -18,6 +20,19 @@ SpectrogramCanvas::~SpectrogramCanvas()
 
 void SpectrogramCanvas::resized()
 {
+	int leftMargin = 60;
+	int rightMargin = 90;
+	int bottomMargin = 40;
+	int topMargin = 40;
+
+	chartLeft = leftMargin;
+	chartRight = std::max(chartLeft + 1, getWidth() - rightMargin);
+	chartBottom = std::max(1, getHeight() - bottomMargin);
+	chartTop = std::min(chartBottom - 1, topMargin);
+
+    chromeImage = Image();
+    updateWelchTrace();
+    repaint();
 }
 
 void SpectrogramCanvas::refreshState()
@@ -26,17 +41,83 @@ void SpectrogramCanvas::refreshState()
 
 void SpectrogramCanvas::update()
 {
+    chromeImage = Image();
+    repaint();
 }
 
 void SpectrogramCanvas::refresh()
 {
-    auto lastDataUpdateTime = processor->getLastDataUpdateTime();
+    // Pipelines replaced while acquiring can only be freed once the audio and
+    // worker threads have moved on; check on every refresh.
+    processor->deleteRetiredPipelines();
+
+    // The axes depend on processor parameters, which can change without update() being called.
+    if (chromeMinFrequency != processor->getLowestShownFrequency()
+        || chromeLogFrequencyAxis != processor->isLogFrequencyAxis()
+        || chromeMaxFrequency != processor->getMaxShownFrequency())
+    {
+        update();
+    }
+
+    // Start over when the displayed channel or the configuration changes; the
+    // history is then a different object, already holding any kept columns.
+    // A source that has gone backwards was restarted as well.
+    auto& source = processor->getSpectrogram();
+    bool restarted = &source != lastSource
+        || processor->getConfigurationNumber() != lastConfigurationNumber
+        || source.getNumColumnsWritten() < spectrogram.getNumColumnsWritten();
+
+    if (restarted)
+    {
+        spectrogram.resize(0, 0);
+        welchAverages.resize(0, 0);
+        lastSource = &source;
+        lastConfigurationNumber = processor->getConfigurationNumber();
+    }
+
+    auto numNewColumns = spectrogram.copyNewColumnsFrom(source);
+    bool sizeChanged = spectrogramImage.getWidth() != spectrogram.getNumColumns()
+        || spectrogramImage.getHeight() != spectrogram.getNumRows();
+
+    // Changing the unit replaces the processor's histories, so the copy only
+    // ever holds columns in the current one; redraw them all.
+    bool unitChanged = colorQuantizer.isDecibelInput() != processor->isDecibelOutput();
+    colorQuantizer.setDecibelInput(processor->isDecibelOutput());
+
+    if (sizeChanged)
+    {
+        spectrogramImage = Image(Image::ARGB, spectrogram.getNumColumns(), spectrogram.getNumRows(), false);
+        columnPixels.resize(spectrogram.getNumRows());
+    }
+
+    // After a restart the image still shows the old columns, and the copy may
+    // hold fewer columns than it does; redraw every slot, blank or not.
+    if (sizeChanged || unitChanged || restarted)
+    {
+        numNewColumns = spectrogram.getNumColumns();
+    }
+
+    bool welchChanged = welchAverages.copyNewColumnsFrom(processor->getWelchAverages()) > 0;
+
+    if (welchChanged || restarted)
+    {
+        updateWelchTrace();
+    }
+
+    if (numNewColumns > 0)
+    {
+        updateSpectrogramImage(numNewColumns);
+        updateTimeLabels();
+
+        // The X axis scrolls with the columns.
+        repaint(0, chartBottom + 1, getWidth(), getHeight() - chartBottom - 1);
+    }
+
+    bool overloadChanged = updateOverloadLabel();
 
-    if (lastDataUpdateTime != drawnToTime)
+    if (numNewColumns > 0 || welchChanged || overloadChanged)
     {
-        drawnToTime = lastDataUpdateTime;
-        //repaintChartOnly = true;
-        repaint();
+        repaint(chartLeft, chartTop, chartRight - chartLeft, chartBottom - chartTop);
     }
 }
 
@@ -52,444 +133,400 @@ void SpectrogramCanvas::endAnimation()
 
 void SpectrogramCanvas::paint(Graphics& g)
 {
-    // Repaint everything for now. There isn't that much extra that needs to be painted on every cycle.
-	int numSpectrogramRows = processor->getNumFreqsPerSpectrigramColumn();
-	int numSpectrogramColumns = processor->getNumSpectrogramColumns();
+    if (getWidth() <= 0 || getHeight() <= 0)
+    {
+        return;
+    }
 
-	int canvasWidth = getWidth();
-	int canvasHeight = getHeight();
+    // Only the chart area changes on data updates. Everything else comes from
+    // the cached chrome, which is re-rendered only after it has been invalidated.
+    if (chromeImage.isNull())
+    {
+        renderChrome();
+    }
 
-	int leftMargin = 60;
-	int rightMargin = 90;
-	int bottomMargin = 40;
-	int topMargin = 40;
+    g.drawImageAt(chromeImage, 0, 0);
 
-	int cellWidth = (canvasWidth - leftMargin - rightMargin) / numSpectrogramColumns;
-	int cellHeight = (canvasHeight - topMargin - bottomMargin) / numSpectrogramRows;
+	int numSpectrogramRows = spectrogram.getNumRows();
+	int numSpectrogramColumns = spectrogram.getNumColumns();
 
-	int chartLeft = leftMargin;
-	int chartRight = chartLeft + cellWidth * numSpectrogramColumns;
-	int chartBottom = canvasHeight - bottomMargin;
-	int chartTop = chartBottom - cellHeight * numSpectrogramRows;
+    if (numSpectrogramRows == 0 || numSpectrogramColumns == 0 || spectrogramImage.isNull())
+    {
+        return;
+    }
 
 	int chartWidth = chartRight - chartLeft;
 	int chartHeight = chartBottom - chartTop;
 
-	// Clear the component.
-    if (!repaintChartOnly)
+	// Draw the spectrogram body. The image holds one pixel per cell, so let the
+	// nearest-neighbour resampler stretch it over the chart area. The image is
+	// circular: the oldest column sits at imageHead, so draw the part from there
+	// to the right edge first, then wrap around to the start of the image.
+    g.setImageResamplingQuality(Graphics::lowResamplingQuality);
+
+    int imageHead = spectrogram.getNumColumnsWritten() % numSpectrogramColumns;
+    int numOlderColumns = numSpectrogramColumns - imageHead;
+    int wrapX = chartLeft + chartWidth * numOlderColumns / numSpectrogramColumns;
+
+    g.drawImage(
+        spectrogramImage, chartLeft, chartTop, wrapX - chartLeft, chartHeight,
+        imageHead, 0, numOlderColumns, numSpectrogramRows);
+
+    if (imageHead > 0)
     {
-        g.setColour(Colours::black);
-        g.fillRect(0, 0, getWidth(), getHeight());
-
-        // Draw the axes
-        g.setColour(Colours::lightgrey);
-        g.drawLine(chartLeft - 1, chartTop, chartLeft - 1, chartBottom + 1);
-        g.drawLine(chartLeft - 1, chartBottom + 1, chartRight, chartBottom + 1);
-
-        // Draw X-axis ticks
-        g.setFont(Font(Font::getDefaultSerifFontName(), 14, Font::plain));
-        auto tickTextWidth = 40;
-        auto tickTextHeight = 20;
-        auto chartLengthSec = processor->getChartLengthSec();
-        const int tickTextMaxLength = 20;
-        char tickText[tickTextMaxLength];
-
-        int numXTicks = 4;
-        if (chartWidth > 800)
-        {
-            numXTicks = 8;
-        }
+        g.drawImage(
+            spectrogramImage, wrapX, chartTop, chartRight - wrapX, chartHeight,
+            0, 0, imageHead, numSpectrogramRows);
+    }
 
-        for (int i = 0; i <= numXTicks; i++)
-        {
-            int tickX = chartLeft - 1 + (chartRight - chartLeft + 1) * i / numXTicks;
-            g.drawLine(tickX, chartBottom + 1, tickX, chartBottom + 6);
+    g.setColour(Colours::white);
+    g.strokePath(welchTrace, PathStrokeType(1.5f));
 
-            auto tickValue = chartLengthSec * (numXTicks - i) / numXTicks;
-            std::snprintf(tickText, tickTextMaxLength, "%.2f s", tickValue);
-            auto tickTextTop = chartBottom + 11;
-            auto tickTextLeft = tickX - tickTextWidth / 2;
+    // X-axis ticks at round acquisition times, under the columns they fall in.
+    g.setColour(Colours::lightgrey);
+    g.setFont(Font(Font::getDefaultSerifFontName(), 14, Font::plain));
 
-            g.drawText(
-                String(tickText), tickTextLeft, tickTextTop, 
-                tickTextWidth, tickTextHeight, Justification::centredTop);
-        }
+    for (auto& tick : timeTicks)
+    {
+        int tickX = chartLeft + int(tick.position * chartWidth);
+        g.drawLine(tickX, chartBottom + 1, tickX, chartBottom + 6);
+        g.drawText(
+            tick.label, tickX - timeTickTextWidth / 2, chartBottom + 11,
+            timeTickTextWidth, 20, Justification::centredTop);
+    }
+
+    g.drawText(latencyLabel, chartRight - 160, chartTop + 2, 156, 20, Justification::centredRight);
+    g.drawText(overloadLabel, chartRight - 260, chartTop + 20, 256, 20, Justification::centredRight);
+}
+
+void SpectrogramCanvas::renderChrome()
+{
+    chromeImage = Image(Image::RGB, getWidth(), getHeight(), false);
+    chromeMinFrequency = processor->getLowestShownFrequency();
+    chromeLogFrequencyAxis = processor->isLogFrequencyAxis();
+    chromeMaxFrequency = processor->getMaxShownFrequency();
+
+    Graphics g(chromeImage);
+
+	int chartHeight = chartBottom - chartTop;
+
+    g.setColour(Colours::black);
+    g.fillRect(0, 0, getWidth(), getHeight());
+
+    // Draw the axes
+    g.setColour(Colours::lightgrey);
+    g.drawLine(chartLeft - 1, chartTop, chartLeft - 1, chartBottom + 1);
+    g.drawLine(chartLeft - 1, chartBottom + 1, chartRight, chartBottom + 1);
+
+    // The X-axis ticks scroll with the data, so paint() draws those.
+    g.setFont(Font(Font::getDefaultSerifFontName(), 14, Font::plain));
+    auto tickTextWidth = 40;
+    auto tickTextHeight = 20;
+    const int tickTextMaxLength = 20;
+    char tickText[tickTextMaxLength];
+
+    // Draw Y-axis ticks. The rows span minFreq to maxFreq; minFreq is 0 unless
+    // the processor is in band or wavelet mode. Wavelet rows are log-spaced.
+    auto minFreq = processor->getLowestShownFrequency();
+    auto maxFreq = processor->getMaxShownFrequency();
+
+    int numYTicks = 5;
+
+    for (int i = 0; i <= numYTicks; i++)
+    {
+        int tickY = chartTop + (chartBottom + 1 - chartTop) * i / numYTicks;
+        g.drawLine(chartLeft - 6, tickY, chartLeft - 1, tickY);
+
+        float fraction = float(numYTicks - i) / numYTicks;
+        auto tickValue = chromeLogFrequencyAxis
+            ? minFreq * std::pow(maxFreq / minFreq, fraction)
+            : minFreq + (maxFreq - minFreq) * fraction;
+        std::snprintf(tickText, tickTextMaxLength, "%.0f Hz", tickValue);
+        auto tickTextLeft = chartLeft - 6 - tickTextWidth - 7;
+        auto tickTextTop = tickY - tickTextHeight / 2;
+
+        g.drawText(
+            String(tickText), tickTextLeft, tickTextTop, 
+            tickTextWidth, tickTextHeight, Justification::centredRight);
+    }
+
+    // Draw the scale.
+    auto scaleCenterX = chartRight + 40;
+    auto scaleWidth = 18;
+    auto scaleLeft = scaleCenterX - scaleWidth / 2;
+    auto scaleRight = scaleLeft + scaleWidth;
+    auto scaleHeight = chartHeight;
+
+    g.setColour(Colours::lightgrey);
+    g.drawText(
+        String("V/sqrt(Hz)"), 
+        scaleCenterX - 30, chartTop - 30, 60, 20, Justification::centredBottom);
+
+    // One pixel per colour level, brightest at the top, stretched over the bar.
+    Image scaleImage(Image::RGB, 1, NUM_COLOR_LEVELS, false);
+
+    for (int i = 0; i < NUM_COLOR_LEVELS; i++)
+    {
+        scaleImage.setPixelAt(0, NUM_COLOR_LEVELS - 1 - i, Colour(infernoPalette[i]));
+    }
+
+    g.setImageResamplingQuality(Graphics::lowResamplingQuality);
+    g.drawImage(
+        scaleImage, scaleLeft, chartTop, scaleWidth, scaleHeight,
+        0, 0, 1, NUM_COLOR_LEVELS);
 
-        // Draw Y-axis ticks
-        auto maxFreq = processor->getMaxShownFrequency();
+    g.setColour(Colours::lightgrey);
+    g.drawLine(scaleLeft, chartTop - 1, scaleLeft, chartBottom + 1);
+    g.drawLine(scaleRight, chartTop - 1, scaleRight, chartBottom + 1);
+    g.drawLine(scaleLeft, chartTop - 1, scaleRight, chartTop - 1);
+    g.drawLine(scaleLeft, chartBottom + 1, scaleRight, chartBottom + 1);
 
-        int numYTicks = 5;
+    // Draw the scale ticks.
+    g.setColour(Colours::lightgrey);
 
-        for (int i = 0; i <= numYTicks; i++)
+    for (int i = 0; i < scaleTicks.size(); i++)
+    {
+        int tickY = chartTop + (float)i / (scaleTicks.size() - 1) * scaleHeight;
+        g.drawLine(scaleRight, tickY, scaleRight + 5, tickY);
+
+        auto tickTextLeft = scaleRight + 10;
+        auto tickTextTop = tickY - tickTextHeight / 2;
+        g.drawText(
+            scaleTicks[i], tickTextLeft, tickTextTop, 
+            tickTextWidth, tickTextHeight, Justification::centredLeft);
+    }
+}
+
+void SpectrogramCanvas::updateSpectrogramImage(int numNewColumns)
+{
+    int numColumns = spectrogram.getNumColumns();
+    int numRows = spectrogram.getNumRows();
+    int64 numColumnsWritten = spectrogram.getNumColumnsWritten();
+
+    // Image column n % numColumns holds history column n, same as the history ring.
+    int firstSlot = ((numColumnsWritten - numNewColumns) % numColumns + numColumns) % numColumns;
+    int firstAge = numColumns - numNewColumns;
+
+    Image::BitmapData pixels(spectrogramImage, Image::BitmapData::writeOnly);
+
+    for (int i = 0; i < numNewColumns; i++)
+    {
+        // Quantized histories already hold palette indices, 16-bit ones in the
+        // top byte.
+        switch (spectrogram.getFormat())
+        {
+        case HISTORY_LEVELS_8:
         {
-            int tickY = chartTop + (chartBottom + 1 - chartTop) * i / numYTicks;
-            g.drawLine(chartLeft - 6, tickY, chartLeft - 1, tickY);
+            auto levels = spectrogram.getColumnLevels8(firstAge + i);
 
-            auto tickValue = maxFreq * (numYTicks - i) / numYTicks;
-            std::snprintf(tickText, tickTextMaxLength, "%.0f Hz", tickValue);
-            auto tickTextLeft = chartLeft - 6 - tickTextWidth - 7;
-            auto tickTextTop = tickY - tickTextHeight / 2;
+            for (int row = 0; row < numRows; row++)
+            {
+                columnPixels[row] = infernoPalette[levels[row]];
+            }
 
-            g.drawText(
-                String(tickText), tickTextLeft, tickTextTop, 
-                tickTextWidth, tickTextHeight, Justification::centredRight);
+            break;
         }
+        case HISTORY_LEVELS_16:
+        {
+            auto levels = spectrogram.getColumnLevels16(firstAge + i);
 
-        // Draw the scale.
-        auto scaleCenterX = chartRight + 40;
-        auto scaleWidth = 18;
-        auto scaleLeft = scaleCenterX - scaleWidth / 2;
-        auto scaleRight = scaleLeft + scaleWidth;
-        auto scaleHeight = chartHeight;
+            for (int row = 0; row < numRows; row++)
+            {
+                columnPixels[row] = infernoPalette[levels[row] >> 8];
+            }
 
-        g.setColour(Colours::lightgrey);
-        g.drawText(
-            String("V/sqrt(Hz)"), 
-            scaleCenterX - 30, chartTop - 30, 60, 20, Justification::centredBottom);
+            break;
+        }
+        default:
+            colorQuantizer.toPixels(spectrogram.getColumn(firstAge + i), columnPixels.data(), numRows);
+            break;
+        }
+
+        // All colours are opaque, so the premultiplied native pixel is just the ARGB value.
+        auto pixel = pixels.getPixelPointer((firstSlot + i) % numColumns, numRows - 1);
 
-        for (int i = 0; i < scaleHeight; i++)
+        for (int row = 0; row < numRows; row++)
         {
-            int y = chartTop + i;
-            int colorIndex = (float)((scaleHeight - i - 1)) / scaleHeight * infernoColors.size();
-            g.setColour(infernoColors[colorIndex]);
-            g.drawLine(scaleLeft, y, scaleLeft + scaleWidth, y, 1);
+            *(uint32_t*)pixel = columnPixels[row];
+            pixel -= pixels.lineStride;
         }
+    }
+}
 
-        g.setColour(Colours::lightgrey);
-        g.drawLine(scaleLeft, chartTop - 1, scaleLeft, chartBottom + 1);
-        g.drawLine(scaleRight, chartTop - 1, scaleRight, chartBottom + 1);
-        g.drawLine(scaleLeft, chartTop - 1, scaleRight, chartTop - 1);
-        g.drawLine(scaleLeft, chartBottom + 1, scaleRight, chartBottom + 1);
+void SpectrogramCanvas::updateTimeLabels()
+{
+    int numColumns = spectrogram.getNumColumns();
+    auto sampleRate = processor->getSampleRate();
+    nextTimeTicks.clear();
 
-        // Draw the scale ticks.
-        g.setColour(Colours::lightgrey);
+    if (numColumns == 0 || sampleRate <= 0)
+    {
+        timeTicks.swap(nextTimeTicks);
+        return;
+    }
 
-        for (int i = 0; i < scaleTicks.size(); i++)
+    // About as many ticks as fit, at 1, 2 or 5 times a power of ten seconds.
+    int numXTicks = (chartRight - chartLeft) > 800 ? 8 : 4;
+    double roughInterval = processor->getChartLengthSec() / numXTicks;
+    double powerOfTen = std::pow(10.0, std::floor(std::log10(roughInterval)));
+    double interval = powerOfTen;
+
+    for (double multiple : { 2.0, 5.0, 10.0 })
+    {
+        if (interval < roughInterval)
         {
-            int tickY = chartTop + (float)i / (scaleTicks.size() - 1) * scaleHeight;
-            g.drawLine(scaleRight, tickY, scaleRight + 5, tickY);
-
-            auto tickTextLeft = scaleRight + 10;
-            auto tickTextTop = tickY - tickTextHeight / 2;
-            g.drawText(
-                scaleTicks[i], tickTextLeft, tickTextTop, 
-                tickTextWidth, tickTextHeight, Justification::centredLeft);
+            interval = multiple * powerOfTen;
         }
     }
-    else
+
+    // Labels are only reused while the interval stays the same.
+    bool sameInterval = interval == timeTickIntervalSec;
+    timeTickIntervalSec = interval;
+    int numDecimals = std::max(0, -int(std::floor(std::log10(interval) + 1e-6)));
+    double samplesPerTick = interval * sampleRate;
+    double previousCentre = -1;
+    size_t oldTick = 0;
+
+    // A tick goes between the two adjacent columns whose centres it falls
+    // between; none is placed across a gap in the samples.
+    for (int i = 0; i < numColumns; i++)
     {
-        repaintChartOnly = false;
+        auto& info = spectrogram.getColumnInfo(i);
+
+        if (info.firstSample < 0)
+        {
+            previousCentre = -1;
+            continue;
+        }
+
+        double centre = info.firstSample + info.numSamples / 2.0;
+        double tickSample = std::ceil(previousCentre / samplesPerTick) * samplesPerTick;
+
+        if (previousCentre >= 0 && tickSample < centre && centre - previousCentre <= samplesPerTick)
+        {
+            TimeTick tick;
+            tick.number = int64(tickSample / samplesPerTick + 0.5);
+            tick.position = float((i - 0.5 + (tickSample - previousCentre) / (centre - previousCentre)) / numColumns);
+
+            while (oldTick < timeTicks.size() && timeTicks[oldTick].number < tick.number)
+            {
+                oldTick++;
+            }
+
+            if (sameInterval && oldTick < timeTicks.size() && timeTicks[oldTick].number == tick.number)
+            {
+                tick.label = timeTicks[oldTick].label;
+            }
+            else
+            {
+                tick.label = String(tick.number * interval, numDecimals) + " s";
+            }
+
+            nextTimeTicks.push_back(tick);
+        }
+
+        previousCentre = centre;
     }
 
+    timeTicks.swap(nextTimeTicks);
+
+    // How far the newest column lags the input, in steps of 10 ms so that it
+    // is only reformatted when it visibly changes.
+    auto& newest = spectrogram.getColumnInfo(numColumns - 1);
+
+    if (newest.firstSample >= 0)
+    {
+        auto endSample = newest.firstSample + newest.numSamples;
+        int newLatencyMs = int((processor->getLatestSampleNumber() - endSample) * 100 / sampleRate) * 10;
 
-	// Draw the spectrogram body.
-	auto& spectrogramValues = processor->getSpectrogram();
-    Colour transparent(0.f, 0.f, 0.f, 0.f);
-    g.setColour(transparent);
-
-	for (int i = 0; i < spectrogramValues.size(); i++)
-	{
-		int col = i / numSpectrogramRows;
-		int row = i % numSpectrogramRows;
-
-		int x = chartLeft + col * cellWidth;
-		int y = chartBottom - (row + 1) * cellHeight;
-		auto value = spectrogramValues[i];
-        
-        FillType fill(colorMap(value));
-        g.setFillType(fill);
-        g.fillRect(x, y, cellWidth, cellHeight);
-	}
+        if (newLatencyMs != latencyMs)
+        {
+            latencyMs = newLatencyMs;
+            latencyLabel = String(latencyMs) + " ms ago";
+        }
+    }
 }
 
-void SpectrogramCanvas::timerCallback()
+bool SpectrogramCanvas::updateOverloadLabel()
 {
-    refresh();
+    auto numDropped = processor->getNumDroppedSamples();
+    auto maxQueued = processor->getMaxQueuedSamples();
+    auto sampleRate = processor->getSampleRate();
+
+    if (numDropped == shownDroppedSamples && maxQueued == shownMaxQueuedSamples)
+    {
+        return false;
+    }
+
+    shownDroppedSamples = numDropped;
+    shownMaxQueuedSamples = maxQueued;
+
+    // Both counters are per channel; show them as input time.
+    if (sampleRate <= 0 || (numDropped == 0 && maxQueued == 0))
+    {
+        overloadLabel = String();
+    }
+    else
+    {
+        overloadLabel = "queued up to " + String(int(maxQueued * 1000 / sampleRate)) + " ms";
+
+        if (numDropped > 0)
+        {
+            overloadLabel += ", dropped " + String(numDropped / sampleRate, 2) + " s";
+        }
+    }
+
+    return true;
 }
 
-const Colour& SpectrogramCanvas::colorMap(float value) const
+void SpectrogramCanvas::updateWelchTrace()
 {
-	float logValue;
+    welchTrace.clear();
 
-    if (std::isnan(value))
+    int numRows = welchAverages.getNumRows();
+
+    if (welchAverages.getNumColumns() == 0 || numRows == 0)
+    {
+        return;
+    }
+
+    // The averages are in V^2/Hz, the square of the densities on the scale.
+    auto powers = welchAverages.getColumn(welchAverages.getNumColumns() - 1);
+    float minLog10 = colorQuantizer.getMinLog10();
+    float log10Range = colorQuantizer.getMaxLog10() - minLog10;
+    float traceWidth = (chartRight - chartLeft) / 5.f;
+    float rowHeight = float(chartBottom - chartTop) / numRows;
+    bool startNewSubPath = true;
+
+    for (int row = 0; row < numRows; row++)
     {
-        return infernoColors[0];
-
-    } else if (value < 1e-20)
-	{
-		logValue = -20;
-	
-	} else {
-		logValue = std::log10(value);
-	}
-
-    auto numColors = infernoColors.size();
-    float min = -7;
-    float max = -1;
-    int colorIndex = ((logValue - min) / (max - min) * (float)numColors);
-    colorIndex = std::min(std::max(0, colorIndex), (int)numColors - 1);
-
-    return infernoColors[colorIndex];
+        // Unwritten or torn averages are NaN; leave a gap for them.
+        if (std::isnan(powers[row]))
+        {
+            startNewSubPath = true;
+            continue;
+        }
+
+        float fraction = (0.5f * std::log10(powers[row]) - minLog10) / log10Range;
+        float x = chartRight - traceWidth + traceWidth * jlimit(0.f, 1.f, fraction);
+        float y = chartBottom - (row + 0.5f) * rowHeight;
+
+        if (startNewSubPath)
+        {
+            welchTrace.startNewSubPath(x, y);
+            startNewSubPath = false;
+        }
+        else
+        {
+            welchTrace.lineTo(x, y);
+        }
+    }
 }
 
-std::vector<Colour> SpectrogramCanvas::infernoColors = {
-    Colour(0, 0, 4),
-    Colour(1, 0, 5),
-    Colour(1, 1, 6),
-    Colour(1, 1, 8),
-    Colour(2, 1, 10),
-    Colour(2, 2, 12),
-    Colour(2, 2, 14),
-    Colour(3, 2, 16),
-    Colour(4, 3, 18),
-    Colour(4, 3, 20),
-    Colour(5, 4, 23),
-    Colour(6, 4, 25),
-    Colour(7, 5, 27),
-    Colour(8, 5, 29),
-    Colour(9, 6, 31),
-    Colour(10, 7, 34),
-    Colour(11, 7, 36),
-    Colour(12, 8, 38),
-    Colour(13, 8, 41),
-    Colour(14, 9, 43),
-    Colour(16, 9, 45),
-    Colour(17, 10, 48),
-    Colour(18, 10, 50),
-    Colour(20, 11, 52),
-    Colour(21, 11, 55),
-    Colour(22, 11, 57),
-    Colour(24, 12, 60),
-    Colour(25, 12, 62),
-    Colour(27, 12, 65),
-    Colour(28, 12, 67),
-    Colour(30, 12, 69),
-    Colour(31, 12, 72),
-    Colour(33, 12, 74),
-    Colour(35, 12, 76),
-    Colour(36, 12, 79),
-    Colour(38, 12, 81),
-    Colour(40, 11, 83),
-    Colour(41, 11, 85),
-    Colour(43, 11, 87),
-    Colour(45, 11, 89),
-    Colour(47, 10, 91),
-    Colour(49, 10, 92),
-    Colour(50, 10, 94),
-    Colour(52, 10, 95),
-    Colour(54, 9, 97),
-    Colour(56, 9, 98),
-    Colour(57, 9, 99),
-    Colour(59, 9, 100),
-    Colour(61, 9, 101),
-    Colour(62, 9, 102),
-    Colour(64, 10, 103),
-    Colour(66, 10, 104),
-    Colour(68, 10, 104),
-    Colour(69, 10, 105),
-    Colour(71, 11, 106),
-    Colour(73, 11, 106),
-    Colour(74, 12, 107),
-    Colour(76, 12, 107),
-    Colour(77, 13, 108),
-    Colour(79, 13, 108),
-    Colour(81, 14, 108),
-    Colour(82, 14, 109),
-    Colour(84, 15, 109),
-    Colour(85, 15, 109),
-    Colour(87, 16, 110),
-    Colour(89, 16, 110),
-    Colour(90, 17, 110),
-    Colour(92, 18, 110),
-    Colour(93, 18, 110),
-    Colour(95, 19, 110),
-    Colour(97, 19, 110),
-    Colour(98, 20, 110),
-    Colour(100, 21, 110),
-    Colour(101, 21, 110),
-    Colour(103, 22, 110),
-    Colour(105, 22, 110),
-    Colour(106, 23, 110),
-    Colour(108, 24, 110),
-    Colour(109, 24, 110),
-    Colour(111, 25, 110),
-    Colour(113, 25, 110),
-    Colour(114, 26, 110),
-    Colour(116, 26, 110),
-    Colour(117, 27, 110),
-    Colour(119, 28, 109),
-    Colour(120, 28, 109),
-    Colour(122, 29, 109),
-    Colour(124, 29, 109),
-    Colour(125, 30, 109),
-    Colour(127, 30, 108),
-    Colour(128, 31, 108),
-    Colour(130, 32, 108),
-    Colour(132, 32, 107),
-    Colour(133, 33, 107),
-    Colour(135, 33, 107),
-    Colour(136, 34, 106),
-    Colour(138, 34, 106),
-    Colour(140, 35, 105),
-    Colour(141, 35, 105),
-    Colour(143, 36, 105),
-    Colour(144, 37, 104),
-    Colour(146, 37, 104),
-    Colour(147, 38, 103),
-    Colour(149, 38, 103),
-    Colour(151, 39, 102),
-    Colour(152, 39, 102),
-    Colour(154, 40, 101),
-    Colour(155, 41, 100),
-    Colour(157, 41, 100),
-    Colour(159, 42, 99),
-    Colour(160, 42, 99),
-    Colour(162, 43, 98),
-    Colour(163, 44, 97),
-    Colour(165, 44, 96),
-    Colour(166, 45, 96),
-    Colour(168, 46, 95),
-    Colour(169, 46, 94),
-    Colour(171, 47, 94),
-    Colour(173, 48, 93),
-    Colour(174, 48, 92),
-    Colour(176, 49, 91),
-    Colour(177, 50, 90),
-    Colour(179, 50, 90),
-    Colour(180, 51, 89),
-    Colour(182, 52, 88),
-    Colour(183, 53, 87),
-    Colour(185, 53, 86),
-    Colour(186, 54, 85),
-    Colour(188, 55, 84),
-    Colour(189, 56, 83),
-    Colour(191, 57, 82),
-    Colour(192, 58, 81),
-    Colour(193, 58, 80),
-    Colour(195, 59, 79),
-    Colour(196, 60, 78),
-    Colour(198, 61, 77),
-    Colour(199, 62, 76),
-    Colour(200, 63, 75),
-    Colour(202, 64, 74),
-    Colour(203, 65, 73),
-    Colour(204, 66, 72),
-    Colour(206, 67, 71),
-    Colour(207, 68, 70),
-    Colour(208, 69, 69),
-    Colour(210, 70, 68),
-    Colour(211, 71, 67),
-    Colour(212, 72, 66),
-    Colour(213, 74, 65),
-    Colour(215, 75, 63),
-    Colour(216, 76, 62),
-    Colour(217, 77, 61),
-    Colour(218, 78, 60),
-    Colour(219, 80, 59),
-    Colour(221, 81, 58),
-    Colour(222, 82, 56),
-    Colour(223, 83, 55),
-    Colour(224, 85, 54),
-    Colour(225, 86, 53),
-    Colour(226, 87, 52),
-    Colour(227, 89, 51),
-    Colour(228, 90, 49),
-    Colour(229, 92, 48),
-    Colour(230, 93, 47),
-    Colour(231, 94, 46),
-    Colour(232, 96, 45),
-    Colour(233, 97, 43),
-    Colour(234, 99, 42),
-    Colour(235, 100, 41),
-    Colour(235, 102, 40),
-    Colour(236, 103, 38),
-    Colour(237, 105, 37),
-    Colour(238, 106, 36),
-    Colour(239, 108, 35),
-    Colour(239, 110, 33),
-    Colour(240, 111, 32),
-    Colour(241, 113, 31),
-    Colour(241, 115, 29),
-    Colour(242, 116, 28),
-    Colour(243, 118, 27),
-    Colour(243, 120, 25),
-    Colour(244, 121, 24),
-    Colour(245, 123, 23),
-    Colour(245, 125, 21),
-    Colour(246, 126, 20),
-    Colour(246, 128, 19),
-    Colour(247, 130, 18),
-    Colour(247, 132, 16),
-    Colour(248, 133, 15),
-    Colour(248, 135, 14),
-    Colour(248, 137, 12),
-    Colour(249, 139, 11),
-    Colour(249, 140, 10),
-    Colour(249, 142, 9),
-    Colour(250, 144, 8),
-    Colour(250, 146, 7),
-    Colour(250, 148, 7),
-    Colour(251, 150, 6),
-    Colour(251, 151, 6),
-    Colour(251, 153, 6),
-    Colour(251, 155, 6),
-    Colour(251, 157, 7),
-    Colour(252, 159, 7),
-    Colour(252, 161, 8),
-    Colour(252, 163, 9),
-    Colour(252, 165, 10),
-    Colour(252, 166, 12),
-    Colour(252, 168, 13),
-    Colour(252, 170, 15),
-    Colour(252, 172, 17),
-    Colour(252, 174, 18),
-    Colour(252, 176, 20),
-    Colour(252, 178, 22),
-    Colour(252, 180, 24),
-    Colour(251, 182, 26),
-    Colour(251, 184, 29),
-    Colour(251, 186, 31),
-    Colour(251, 188, 33),
-    Colour(251, 190, 35),
-    Colour(250, 192, 38),
-    Colour(250, 194, 40),
-    Colour(250, 196, 42),
-    Colour(250, 198, 45),
-    Colour(249, 199, 47),
-    Colour(249, 201, 50),
-    Colour(249, 203, 53),
-    Colour(248, 205, 55),
-    Colour(248, 207, 58),
-    Colour(247, 209, 61),
-    Colour(247, 211, 64),
-    Colour(246, 213, 67),
-    Colour(246, 215, 70),
-    Colour(245, 217, 73),
-    Colour(245, 219, 76),
-    Colour(244, 221, 79),
-    Colour(244, 223, 83),
-    Colour(244, 225, 86),
-    Colour(243, 227, 90),
-    Colour(243, 229, 93),
-    Colour(242, 230, 97),
-    Colour(242, 232, 101),
-    Colour(242, 234, 105),
-    Colour(241, 236, 109),
-    Colour(241, 237, 113),
-    Colour(241, 239, 117),
-    Colour(241, 241, 121),
-    Colour(242, 242, 125),
-    Colour(242, 244, 130),
-    Colour(243, 245, 134),
-    Colour(243, 246, 138),
-    Colour(244, 248, 142),
-    Colour(245, 249, 146),
-    Colour(246, 250, 150),
-    Colour(248, 251, 154),
-    Colour(249, 252, 157),
-    Colour(250, 253, 161),
-    Colour(252, 255, 164)
-};
+void SpectrogramCanvas::timerCallback()
+{
+    refresh();
+}
 
 std::vector<String> SpectrogramCanvas::scaleTicks = {
     String("100m"),
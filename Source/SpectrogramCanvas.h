@@ -2,6 +2,9 @@
 
 #include <VisualizerWindowHeaders.h>
 
+#include "ColorMap.h"
+#include "SpectrogramHistory.h"
+
 
 namespace SpectrogramViewer
 {
@@ -68,13 +71,84 @@ public:
 
 private:
 	SpectrogramNode* processor;
-    const Colour& colorMap(float value) const;
 
-    static std::vector<Colour> infernoColors;
+    /** Draws the background, axes, ticks and colour scale into chromeImage. */
+    void renderChrome();
+
+    /** Rasterizes the newest columns of the history into spectrogramImage. */
+    void updateSpectrogramImage(int numNewColumns);
+
+    /** Places the X-axis ticks at round acquisition times under the columns of
+    the copy, and updates the latency label. Labels are formatted only for
+    ticks that weren't shown before. */
+    void updateTimeLabels();
+
+    /** Formats the worker backlog and dropped samples under the latency label,
+    only when they change. Returns true if the label changed. */
+    bool updateOverloadLabel();
+
+    /** Rebuilds welchTrace from the newest Welch average, in chart coordinates. */
+    void updateWelchTrace();
+
     static std::vector<String> scaleTicks;
 
-    int64 drawnToTime = 0;
-    bool repaintChartOnly = false;
+    // Maps history values to palette colours; its range matches scaleTicks
+    // whether the values are magnitudes or dB.
+    ColorQuantizer colorQuantizer;
+    std::vector<uint32_t> columnPixels;
+
+    // Message thread copy of the processor's history; only new columns are copied in.
+    SpectrogramHistory spectrogram;
+    const SpectrogramHistory* lastSource = nullptr;
+    int lastConfigurationNumber = -1;
+
+    // Message thread copy of the displayed channel's Welch averages. The newest
+    // one is drawn as a trace over the right fifth of the chart, with the PSD
+    // running left to right on the colour scale's range.
+    SpectrogramHistory welchAverages;
+    Path welchTrace;
+
+    // Spectrogram body with one column of pixels per history column and the
+    // highest frequency in the top row. Used as a ring, in step with the history,
+    // so only new columns are rasterized. Scaled to the chart area when painted.
+    Image spectrogramImage;
+
+    // Everything except the spectrogram body. Re-rendered on the next paint()
+    // after resized() or a parameter change resets it to a null image.
+    Image chromeImage;
+    float chromeMinFrequency = 0;
+    bool chromeLogFrequencyAxis = false;
+    float chromeMaxFrequency = 0;
+
+    // X-axis ticks, at multiples of timeTickIntervalSec since the start of
+    // acquisition. They scroll with the columns, so they are kept outside the
+    // chrome; nextTimeTicks is only the buffer they are rebuilt in.
+    struct TimeTick
+    {
+        int64 number;
+        float position;  // fraction of the chart width from its left edge
+        String label;
+    };
+
+    std::vector<TimeTick> timeTicks;
+    std::vector<TimeTick> nextTimeTicks;
+    double timeTickIntervalSec = 0;
+    static const int timeTickTextWidth = 60;
+
+    // How long before the latest input the newest column ends.
+    int latencyMs = -1;
+    String latencyLabel;
+
+    // The processor's worker backlog counters as last formatted.
+    int64 shownDroppedSamples = -1;
+    int shownMaxQueuedSamples = -1;
+    String overloadLabel;
+
+    // Area covered by the spectrogram body, set in resized().
+    int chartLeft = 0;
+    int chartRight = 1;
+    int chartTop = 0;
+    int chartBottom = 1;
 
 	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SpectrogramCanvas);
 };
@@ -9,11 +9,20 @@ SpectrogramEditor::SpectrogramEditor(SpectrogramNode* processor)
 {
 
 	tabText = "Spectrogram";
-	desiredWidth = 205;
+	desiredWidth = 850;
 
 	lastMaxFreqString = String(roundFloatToInt(processor->getMaxShownFrequency()));
+	lastMinFreqString = String(roundFloatToInt(processor->getMinShownFrequency()));
 	lastStepLengthString = String(roundFloatToInt(processor->getStepLengthSec() * 1000));
 	lastChartLengthString = String(roundFloatToInt(processor->getChartLengthSec() * 1000));
+	lastChannelsString = "";
+	lastFftThreadsString = String(processor->getNumFftThreads());
+	lastWindowLengthString = String(roundFloatToInt(processor->getWindowLengthSec() * 1000));
+	lastNumTapersString = String(processor->getNumTapers());
+	lastWelchSegmentsString = String(processor->getNumWelchSegments());
+	lastWaveletCyclesString = String(processor->getWaveletCycles());
+	lastScalesPerOctaveString = String(processor->getScalesPerOctave());
+	lastTimeHalfBandwidthString = String(processor->getTimeHalfBandwidth());
 
 	// Channel picker
 	channelLabel = new Label("ChannelLabel", "Channel");
@@ -66,7 +75,7 @@ SpectrogramEditor::SpectrogramEditor(SpectrogramNode* processor)
 	stepLengthTextbox->setColour(Label::textColourId, Colours::black);
 	stepLengthTextbox->setColour(Label::backgroundColourId, Colours::lightgrey);
 	stepLengthTextbox->setEditable(true);
-	stepLengthTextbox->setTooltip("Time step in each spectrogram vertical bar");
+	stepLengthTextbox->setTooltip("Time step in each spectrogram vertical bar, i.e. the hop between windows");
 	addAndMakeVisible(stepLengthTextbox);
 
 	stepLengthUnitLabel = new Label("stepLengthUnitLabel", "ms");
@@ -98,6 +107,286 @@ SpectrogramEditor::SpectrogramEditor(SpectrogramNode* processor)
 	chartLengthUnitLabel->setColour(Label::textColourId, Colours::black);
 	addAndMakeVisible(chartLengthUnitLabel);
 
+	// Additional channels textbox
+	channelsLabel = new Label("channelsLabel", "Also compute");
+	channelsLabel->setFont(Font(Font::getDefaultSerifFontName(), 14, Font::plain));
+	channelsLabel->setBounds(190, 25, 85, 20);
+	channelsLabel->setColour(Label::textColourId, Colours::black);
+	addAndMakeVisible(channelsLabel);
+
+	channelsTextbox = new Label("channelsTextbox", lastChannelsString);
+	channelsTextbox->setBounds(190, 50, 145, 22);
+	channelsTextbox->addListener(this);
+	channelsTextbox->setFont(Font(Font::getDefaultSerifFontName(), 14, Font::plain));
+	channelsTextbox->setColour(Label::textColourId, Colours::black);
+	channelsTextbox->setColour(Label::backgroundColourId, Colours::lightgrey);
+	channelsTextbox->setEditable(true);
+	channelsTextbox->setTooltip("Other channels to compute spectrograms for, e.g. 1-32, 40");
+	addAndMakeVisible(channelsTextbox);
+
+	// What happens to the history on a settings change
+	keepHistorySelector = new ComboBox("Keep History ComboBox");
+	keepHistorySelector->setBounds(280, 25, 55, 22);
+	keepHistorySelector->addListener(this);
+	keepHistorySelector->addItem("Clear", 1);
+	keepHistorySelector->addItem("Keep", 2);
+	keepHistorySelector->setSelectedId(processor->getKeepHistory() + 1, dontSendNotification);
+	keepHistorySelector->setTooltip("On a settings change, clear the history or keep it, resampled to the new frequencies and step");
+	addAndMakeVisible(keepHistorySelector);
+
+	// FFT threads textbox
+	fftThreadsLabel = new Label("fftThreadsLabel", "FFT threads");
+	fftThreadsLabel->setFont(Font(Font::getDefaultSerifFontName(), 14, Font::plain));
+	fftThreadsLabel->setBounds(190, 75, 85, 20);
+	fftThreadsLabel->setColour(Label::textColourId, Colours::black);
+	addAndMakeVisible(fftThreadsLabel);
+
+	fftThreadsTextbox = new Label("fftThreadsTextbox", lastFftThreadsString);
+	fftThreadsTextbox->setBounds(280, 75, 55, 22);
+	fftThreadsTextbox->addListener(this);
+	fftThreadsTextbox->setFont(Font(Font::getDefaultSerifFontName(), 14, Font::plain));
+	fftThreadsTextbox->setColour(Label::textColourId, Colours::black);
+	fftThreadsTextbox->setColour(Label::backgroundColourId, Colours::lightgrey);
+	fftThreadsTextbox->setEditable(true);
+	fftThreadsTextbox->setTooltip("Number of threads that share the FFTs of all channels");
+	addAndMakeVisible(fftThreadsTextbox);
+
+	// Overload policy picker
+	overloadLabel = new Label("overloadLabel", "If behind");
+	overloadLabel->setFont(Font(Font::getDefaultSerifFontName(), 14, Font::plain));
+	overloadLabel->setBounds(190, 100, 85, 20);
+	overloadLabel->setColour(Label::textColourId, Colours::black);
+	addAndMakeVisible(overloadLabel);
+
+	overloadSelector = new ComboBox("Overload ComboBox");
+	overloadSelector->setBounds(280, 100, 55, 22);
+	overloadSelector->addListener(this);
+	overloadSelector->addItem("Lag", SpectrogramNode::OVERLOAD_LAG + 1);
+	overloadSelector->addItem("Drop", SpectrogramNode::OVERLOAD_DROP + 1);
+	overloadSelector->setSelectedId(processor->getOverloadPolicy() + 1, dontSendNotification);
+	overloadSelector->setTooltip("Let the display lag, or drop samples, when the spectrogram can't keep up");
+	addAndMakeVisible(overloadSelector);
+
+	// Window length textbox
+	windowLengthLabel = new Label("windowLengthLabel", "Window length");
+	windowLengthLabel->setFont(Font(Font::getDefaultSerifFontName(), 14, Font::plain));
+	windowLengthLabel->setBounds(345, 25, 85, 20);
+	windowLengthLabel->setColour(Label::textColourId, Colours::black);
+	addAndMakeVisible(windowLengthLabel);
+
+	windowLengthTextbox = new Label("windowLengthTextbox", lastWindowLengthString);
+	windowLengthTextbox->setBounds(435, 25, 55, 22);
+	windowLengthTextbox->addListener(this);
+	windowLengthTextbox->setFont(Font(Font::getDefaultSerifFontName(), 14, Font::plain));
+	windowLengthTextbox->setColour(Label::textColourId, Colours::black);
+	windowLengthTextbox->setColour(Label::backgroundColourId, Colours::lightgrey);
+	windowLengthTextbox->setEditable(true);
+	windowLengthTextbox->setTooltip("Length of the FFT window; windows overlap when longer than the step");
+	addAndMakeVisible(windowLengthTextbox);
+
+	windowLengthUnitLabel = new Label("windowLengthUnitLabel", "ms");
+	windowLengthUnitLabel->setFont(Font(Font::getDefaultSerifFontName(), 14, Font::plain));
+	windowLengthUnitLabel->setBounds(490, 25, 25, 20);
+	windowLengthUnitLabel->setColour(Label::textColourId, Colours::black);
+	addAndMakeVisible(windowLengthUnitLabel);
+
+	// Window function picker
+	windowFunctionLabel = new Label("windowFunctionLabel", "Window");
+	windowFunctionLabel->setFont(Font(Font::getDefaultSerifFontName(), 14, Font::plain));
+	windowFunctionLabel->setBounds(345, 50, 85, 20);
+	windowFunctionLabel->setColour(Label::textColourId, Colours::black);
+	addAndMakeVisible(windowFunctionLabel);
+
+	windowFunctionSelector = new ComboBox("Window ComboBox");
+	windowFunctionSelector->setBounds(435, 50, 80, 22);
+	windowFunctionSelector->addListener(this);
+	windowFunctionSelector->addItem("Rectangular", WINDOW_RECTANGULAR + 1);
+	windowFunctionSelector->addItem("Hann", WINDOW_HANN + 1);
+	windowFunctionSelector->addItem("Hamming", WINDOW_HAMMING + 1);
+	windowFunctionSelector->addItem("Blackman-Harris", WINDOW_BLACKMAN_HARRIS + 1);
+	windowFunctionSelector->addItem("Kaiser", WINDOW_KAISER + 1);
+	windowFunctionSelector->setSelectedId(processor->getWindowFunction() + 1, dontSendNotification);
+	windowFunctionSelector->setTooltip("Window applied to each FFT frame");
+	addAndMakeVisible(windowFunctionSelector);
+
+	// Min frequency textbox
+	minFreqLabel = new Label("minFreqLabel", "Min frequency");
+	minFreqLabel->setFont(Font(Font::getDefaultSerifFontName(), 14, Font::plain));
+	minFreqLabel->setBounds(345, 75, 85, 20);
+	minFreqLabel->setColour(Label::textColourId, Colours::black);
+	addAndMakeVisible(minFreqLabel);
+
+	minFreqTextbox = new Label("minFreqTextbox", lastMinFreqString);
+	minFreqTextbox->setBounds(435, 75, 55, 22);
+	minFreqTextbox->addListener(this);
+	minFreqTextbox->setFont(Font(Font::getDefaultSerifFontName(), 14, Font::plain));
+	minFreqTextbox->setColour(Label::textColourId, Colours::black);
+	minFreqTextbox->setColour(Label::backgroundColourId, Colours::lightgrey);
+	minFreqTextbox->setEditable(true);
+	minFreqTextbox->setTooltip("Minimum frequency to display; above 0 Hz, only that band is computed, at full resolution");
+	addAndMakeVisible(minFreqTextbox);
+
+	minFreqUnitLabel = new Label("minFreqUnitLabel", "Hz");
+	minFreqUnitLabel->setFont(Font(Font::getDefaultSerifFontName(), 14, Font::plain));
+	minFreqUnitLabel->setBounds(490, 75, 25, 20);
+	minFreqUnitLabel->setColour(Label::textColourId, Colours::black);
+	addAndMakeVisible(minFreqUnitLabel);
+
+	// Multitaper textboxes
+	numTapersLabel = new Label("numTapersLabel", "Tapers");
+	numTapersLabel->setFont(Font(Font::getDefaultSerifFontName(), 14, Font::plain));
+	numTapersLabel->setBounds(345, 100, 50, 20);
+	numTapersLabel->setColour(Label::textColourId, Colours::black);
+	addAndMakeVisible(numTapersLabel);
+
+	numTapersTextbox = new Label("numTapersTextbox", lastNumTapersString);
+	numTapersTextbox->setBounds(395, 100, 30, 22);
+	numTapersTextbox->addListener(this);
+	numTapersTextbox->setFont(Font(Font::getDefaultSerifFontName(), 14, Font::plain));
+	numTapersTextbox->setColour(Label::textColourId, Colours::black);
+	numTapersTextbox->setColour(Label::backgroundColourId, Colours::lightgrey);
+	numTapersTextbox->setEditable(true);
+	numTapersTextbox->setTooltip("Number of DPSS tapers; 1 uses the window function instead");
+	addAndMakeVisible(numTapersTextbox);
+
+	timeHalfBandwidthLabel = new Label("timeHalfBandwidthLabel", "NW");
+	timeHalfBandwidthLabel->setFont(Font(Font::getDefaultSerifFontName(), 14, Font::plain));
+	timeHalfBandwidthLabel->setBounds(435, 100, 30, 20);
+	timeHalfBandwidthLabel->setColour(Label::textColourId, Colours::black);
+	addAndMakeVisible(timeHalfBandwidthLabel);
+
+	timeHalfBandwidthTextbox = new Label("timeHalfBandwidthTextbox", lastTimeHalfBandwidthString);
+	timeHalfBandwidthTextbox->setBounds(465, 100, 50, 22);
+	timeHalfBandwidthTextbox->addListener(this);
+	timeHalfBandwidthTextbox->setFont(Font(Font::getDefaultSerifFontName(), 14, Font::plain));
+	timeHalfBandwidthTextbox->setColour(Label::textColourId, Colours::black);
+	timeHalfBandwidthTextbox->setColour(Label::backgroundColourId, Colours::lightgrey);
+	timeHalfBandwidthTextbox->setEditable(true);
+	timeHalfBandwidthTextbox->setTooltip("Time-half-bandwidth product of the tapers");
+	addAndMakeVisible(timeHalfBandwidthTextbox);
+
+	// Welch average length textbox
+	welchSegmentsLabel = new Label("welchSegmentsLabel", "PSD segments");
+	welchSegmentsLabel->setFont(Font(Font::getDefaultSerifFontName(), 14, Font::plain));
+	welchSegmentsLabel->setBounds(525, 25, 85, 20);
+	welchSegmentsLabel->setColour(Label::textColourId, Colours::black);
+	addAndMakeVisible(welchSegmentsLabel);
+
+	welchSegmentsTextbox = new Label("welchSegmentsTextbox", lastWelchSegmentsString);
+	welchSegmentsTextbox->setBounds(615, 25, 55, 22);
+	welchSegmentsTextbox->addListener(this);
+	welchSegmentsTextbox->setFont(Font(Font::getDefaultSerifFontName(), 14, Font::plain));
+	welchSegmentsTextbox->setColour(Label::textColourId, Colours::black);
+	welchSegmentsTextbox->setColour(Label::backgroundColourId, Colours::lightgrey);
+	welchSegmentsTextbox->setEditable(true);
+	welchSegmentsTextbox->setTooltip("Number of most recent columns averaged into the Welch PSD");
+	addAndMakeVisible(welchSegmentsTextbox);
+
+	// Wavelet cycles textbox
+	waveletCyclesLabel = new Label("waveletCyclesLabel", "Wavelet cycles");
+	waveletCyclesLabel->setFont(Font(Font::getDefaultSerifFontName(), 14, Font::plain));
+	waveletCyclesLabel->setBounds(525, 50, 85, 20);
+	waveletCyclesLabel->setColour(Label::textColourId, Colours::black);
+	addAndMakeVisible(waveletCyclesLabel);
+
+	waveletCyclesTextbox = new Label("waveletCyclesTextbox", lastWaveletCyclesString);
+	waveletCyclesTextbox->setBounds(615, 50, 55, 22);
+	waveletCyclesTextbox->addListener(this);
+	waveletCyclesTextbox->setFont(Font(Font::getDefaultSerifFontName(), 14, Font::plain));
+	waveletCyclesTextbox->setColour(Label::textColourId, Colours::black);
+	waveletCyclesTextbox->setColour(Label::backgroundColourId, Colours::lightgrey);
+	waveletCyclesTextbox->setEditable(true);
+	waveletCyclesTextbox->setTooltip("Cycles per Morlet wavelet; 0 uses the short-time FFT instead");
+	addAndMakeVisible(waveletCyclesTextbox);
+
+	// Rows per octave textbox, for wavelet scales and the log axis
+	scalesPerOctaveLabel = new Label("scalesPerOctaveLabel", "Rows/octave");
+	scalesPerOctaveLabel->setFont(Font(Font::getDefaultSerifFontName(), 14, Font::plain));
+	scalesPerOctaveLabel->setBounds(525, 75, 85, 20);
+	scalesPerOctaveLabel->setColour(Label::textColourId, Colours::black);
+	addAndMakeVisible(scalesPerOctaveLabel);
+
+	scalesPerOctaveTextbox = new Label("scalesPerOctaveTextbox", lastScalesPerOctaveString);
+	scalesPerOctaveTextbox->setBounds(615, 75, 55, 22);
+	scalesPerOctaveTextbox->addListener(this);
+	scalesPerOctaveTextbox->setFont(Font(Font::getDefaultSerifFontName(), 14, Font::plain));
+	scalesPerOctaveTextbox->setColour(Label::textColourId, Colours::black);
+	scalesPerOctaveTextbox->setColour(Label::backgroundColourId, Colours::lightgrey);
+	scalesPerOctaveTextbox->setEditable(true);
+	scalesPerOctaveTextbox->setTooltip("Number of rows per octave of frequency on a log axis");
+	addAndMakeVisible(scalesPerOctaveTextbox);
+
+	// Frequency axis selector
+	frequencyAxisLabel = new Label("frequencyAxisLabel", "Freq. axis");
+	frequencyAxisLabel->setFont(Font(Font::getDefaultSerifFontName(), 14, Font::plain));
+	frequencyAxisLabel->setBounds(525, 100, 85, 20);
+	frequencyAxisLabel->setColour(Label::textColourId, Colours::black);
+	addAndMakeVisible(frequencyAxisLabel);
+
+	frequencyAxisSelector = new ComboBox("Frequency Axis ComboBox");
+	frequencyAxisSelector->setBounds(615, 100, 55, 22);
+	frequencyAxisSelector->addListener(this);
+	frequencyAxisSelector->addItem("Linear", 1);
+	frequencyAxisSelector->addItem("Log", 2);
+	frequencyAxisSelector->setSelectedId(processor->getLogFrequencyAxis() + 1, dontSendNotification);
+	frequencyAxisSelector->setTooltip("Spacing of the spectrogram rows; wavelets always use a log axis");
+	addAndMakeVisible(frequencyAxisSelector);
+
+	// FFT length selector
+	fftSizeLabel = new Label("fftSizeLabel", "FFT size");
+	fftSizeLabel->setFont(Font(Font::getDefaultSerifFontName(), 14, Font::plain));
+	fftSizeLabel->setBounds(680, 25, 85, 20);
+	fftSizeLabel->setColour(Label::textColourId, Colours::black);
+	addAndMakeVisible(fftSizeLabel);
+
+	fftSizeSelector = new ComboBox("FFT Size ComboBox");
+	fftSizeSelector->setBounds(770, 25, 70, 22);
+	fftSizeSelector->addListener(this);
+	fftSizeSelector->addItem("Exact", 1);
+	fftSizeSelector->addItem("Fast", 2);
+	fftSizeSelector->setSelectedId(processor->getPadFftToFastLength() + 1, dontSendNotification);
+	fftSizeSelector->setTooltip("Exact: transform the window as is; Fast: zero-pad it to a length pocketfft handles quickly");
+	addAndMakeVisible(fftSizeSelector);
+
+	// Effective FFT length and cost, for information
+	fftLengthInfoLabel = new Label("fftLengthInfoLabel", "");
+	fftLengthInfoLabel->setFont(Font(Font::getDefaultSerifFontName(), 14, Font::plain));
+	fftLengthInfoLabel->setBounds(680, 50, 160, 20);
+	fftLengthInfoLabel->setColour(Label::textColourId, Colours::black);
+	addAndMakeVisible(fftLengthInfoLabel);
+
+	fftCostInfoLabel = new Label("fftCostInfoLabel", "");
+	fftCostInfoLabel->setFont(Font(Font::getDefaultSerifFontName(), 14, Font::plain));
+	fftCostInfoLabel->setBounds(680, 75, 160, 20);
+	fftCostInfoLabel->setColour(Label::textColourId, Colours::black);
+	fftCostInfoLabel->setTooltip("Expected worker time per step for all channels, from the FFT cost model");
+	addAndMakeVisible(fftCostInfoLabel);
+
+	// Unit of the stored columns
+	outputUnitLabel = new Label("outputUnitLabel", "Values");
+	outputUnitLabel->setFont(Font(Font::getDefaultSerifFontName(), 14, Font::plain));
+	outputUnitLabel->setBounds(680, 100, 85, 20);
+	outputUnitLabel->setColour(Label::textColourId, Colours::black);
+	addAndMakeVisible(outputUnitLabel);
+
+	outputUnitSelector = new ComboBox("Output Unit ComboBox");
+	outputUnitSelector->setBounds(770, 100, 70, 22);
+	outputUnitSelector->addListener(this);
+	outputUnitSelector->addItem("Linear", 1);
+	outputUnitSelector->addItem("dB", 2);
+	outputUnitSelector->addItem("8-bit", 3);
+	outputUnitSelector->addItem("16-bit", 4);
+	outputUnitSelector->setSelectedId(
+		processor->getHistoryFormat() == HISTORY_FLOAT
+			? processor->isDecibelOutput() + 1
+			: processor->getHistoryFormat() + 2,
+		dontSendNotification);
+	outputUnitSelector->setTooltip(
+		"Linear: store magnitudes; dB: store their log as columns are computed, so the display only rescales it; "
+		"8-bit: store colour levels, 4x less memory; 16-bit: finer levels, 2x less memory");
+	addAndMakeVisible(outputUnitSelector);
+
+	updateFftInfo();
 }
 
 SpectrogramEditor::~SpectrogramEditor()
@@ -117,9 +406,59 @@ void SpectrogramEditor::comboBoxChanged(ComboBox* comboBox)
 		int channelNum = channelSelector->getSelectedId() - 2;
 		getProcessor()->setParameter(SpectrogramNode::PARAM_CHANNEL, channelNum);
 	}
+
+	if (comboBox == overloadSelector)
+	{
+		int policy = overloadSelector->getSelectedId() - 1;
+		getProcessor()->setParameter(SpectrogramNode::PARAM_OVERLOAD_POLICY, policy);
+	}
+
+	if (comboBox == keepHistorySelector)
+	{
+		int keep = keepHistorySelector->getSelectedId() - 1;
+		getProcessor()->setParameter(SpectrogramNode::PARAM_KEEP_HISTORY, keep);
+	}
+
+	if (comboBox == windowFunctionSelector)
+	{
+		int function = windowFunctionSelector->getSelectedId() - 1;
+		getProcessor()->setParameter(SpectrogramNode::PARAM_WINDOW_FUNCTION, function);
+	}
+
+	if (comboBox == frequencyAxisSelector)
+	{
+		int isLog = frequencyAxisSelector->getSelectedId() - 1;
+		getProcessor()->setParameter(SpectrogramNode::PARAM_LOG_FREQUENCY_AXIS, isLog);
+	}
+
+	if (comboBox == fftSizeSelector)
+	{
+		int isPadded = fftSizeSelector->getSelectedId() - 1;
+		getProcessor()->setParameter(SpectrogramNode::PARAM_PAD_FFT, isPadded);
+	}
+
+	if (comboBox == outputUnitSelector)
+	{
+		// Linear and dB are both float histories; the other two are quantized
+		// and keep whichever unit was last chosen.
+		auto processor = (SpectrogramNode*)getProcessor();
+		int id = outputUnitSelector->getSelectedId();
+		bool decibelOutput = (id <= 2) ? id == 2 : processor->isDecibelOutput();
+		HistoryFormat format = (id <= 2) ? HISTORY_FLOAT : HistoryFormat(id - 2);
+
+		processor->setOutputFormat(decibelOutput, format);
+	}
+
+	updateFftInfo();
 }
 
 void SpectrogramEditor::labelTextChanged(Label* label)
+{
+	applyLabelText(label);
+	updateFftInfo();
+}
+
+void SpectrogramEditor::applyLabelText(Label* label)
 {
 	auto processor = (SpectrogramNode*)getProcessor();
 	auto rawValue = label->getTextValue();
@@ -127,7 +466,7 @@ void SpectrogramEditor::labelTextChanged(Label* label)
 
 	if (label == maxFreqTextbox)
 	{
-		if (value < 2 || value > 1000)
+		if (value < 2 || value > 1000 || value <= processor->getMinShownFrequency())
 		{
 			CoreServices::sendStatusMessage("Max spectrogram frequency out of range.");
 			label->setText(lastMaxFreqString, dontSendNotification);
@@ -139,6 +478,92 @@ void SpectrogramEditor::labelTextChanged(Label* label)
 		return;
 	}
 
+	if (label == minFreqTextbox)
+	{
+		if (value < 0 || value >= processor->getMaxShownFrequency())
+		{
+			CoreServices::sendStatusMessage("Min spectrogram frequency out of range.");
+			label->setText(lastMinFreqString, dontSendNotification);
+			return;
+		}
+
+		processor->setParameter(SpectrogramNode::PARAM_MIN_SHOWN_FREQ, value);
+		lastMinFreqString = label->getText();
+		return;
+	}
+
+	if (label == numTapersTextbox)
+	{
+		// Only the first 2NW - 1 or so tapers are well concentrated.
+		if (value < 1 || value > 16 || value != int(value) || value > 2 * processor->getTimeHalfBandwidth())
+		{
+			CoreServices::sendStatusMessage("Spectrogram taper count out of range.");
+			label->setText(lastNumTapersString, dontSendNotification);
+			return;
+		}
+
+		processor->setParameter(SpectrogramNode::PARAM_NUM_TAPERS, value);
+		lastNumTapersString = label->getText();
+		return;
+	}
+
+	if (label == timeHalfBandwidthTextbox)
+	{
+		if (value < 1 || value > 10 || processor->getNumTapers() > 2 * value)
+		{
+			CoreServices::sendStatusMessage("Spectrogram time-half-bandwidth out of range.");
+			label->setText(lastTimeHalfBandwidthString, dontSendNotification);
+			return;
+		}
+
+		processor->setParameter(SpectrogramNode::PARAM_TIME_HALF_BANDWIDTH, value);
+		lastTimeHalfBandwidthString = label->getText();
+		return;
+	}
+
+	if (label == welchSegmentsTextbox)
+	{
+		if (value < 1 || value > 1000)
+		{
+			CoreServices::sendStatusMessage("Spectrogram PSD segment count out of range.");
+			label->setText(lastWelchSegmentsString, dontSendNotification);
+			return;
+		}
+
+		processor->setParameter(SpectrogramNode::PARAM_WELCH_SEGMENTS, value);
+		lastWelchSegmentsString = label->getText();
+		return;
+	}
+
+	if (label == waveletCyclesTextbox)
+	{
+		// Fewer than about 3 cycles and the wavelet no longer has a zero mean.
+		if (value != 0 && (value < 3 || value > 20))
+		{
+			CoreServices::sendStatusMessage("Spectrogram wavelet cycles out of range.");
+			label->setText(lastWaveletCyclesString, dontSendNotification);
+			return;
+		}
+
+		processor->setParameter(SpectrogramNode::PARAM_WAVELET_CYCLES, value);
+		lastWaveletCyclesString = label->getText();
+		return;
+	}
+
+	if (label == scalesPerOctaveTextbox)
+	{
+		if (value < 1 || value > 48 || value != int(value))
+		{
+			CoreServices::sendStatusMessage("Spectrogram rows per octave out of range.");
+			label->setText(lastScalesPerOctaveString, dontSendNotification);
+			return;
+		}
+
+		processor->setParameter(SpectrogramNode::PARAM_SCALES_PER_OCTAVE, value);
+		lastScalesPerOctaveString = label->getText();
+		return;
+	}
+
 	if (label == stepLengthTextbox)
 	{
 		if (value < 2 || value > 1000)
@@ -166,6 +591,118 @@ void SpectrogramEditor::labelTextChanged(Label* label)
 		lastChartLengthString = label->getText();
 		return;
 	}
+
+	if (label == channelsTextbox)
+	{
+		std::vector<int> channels;
+
+		if (!parseChannelList(label->getText(), channels))
+		{
+			CoreServices::sendStatusMessage("Spectrogram channel list is invalid.");
+			label->setText(lastChannelsString, dontSendNotification);
+			return;
+		}
+
+		processor->setRequestedChannels(channels);
+		lastChannelsString = label->getText();
+		return;
+	}
+
+	if (label == fftThreadsTextbox)
+	{
+		if (value < 1 || value > 64)
+		{
+			CoreServices::sendStatusMessage("Spectrogram FFT thread count out of range.");
+			label->setText(lastFftThreadsString, dontSendNotification);
+			return;
+		}
+
+		processor->setParameter(SpectrogramNode::PARAM_NUM_FFT_THREADS, value);
+		lastFftThreadsString = label->getText();
+		return;
+	}
+
+	if (label == windowLengthTextbox)
+	{
+		if (value < 2 || value > 10000)
+		{
+			CoreServices::sendStatusMessage("Spectrogram window length out of range.");
+			label->setText(lastWindowLengthString, dontSendNotification);
+			return;
+		}
+
+		processor->setParameter(SpectrogramNode::PARAM_WINDOW_LENGTH_SEC, value / 1000);
+		lastWindowLengthString = label->getText();
+		return;
+	}
+}
+
+bool SpectrogramEditor::parseChannelList(const String& text, std::vector<int>& channels) const
+{
+	int numChannels = getProcessor()->getTotalDataChannels();
+	auto ranges = StringArray::fromTokens(text, ",", "");
+
+	for (auto& range : ranges)
+	{
+		auto trimmed = range.trim();
+
+		if (trimmed.isEmpty())
+		{
+			continue;
+		}
+
+		if (!trimmed.containsOnly("0123456789-"))
+		{
+			return false;
+		}
+
+		int from = trimmed.upToFirstOccurrenceOf("-", false, false).getIntValue();
+		int to = trimmed.contains("-")
+			? trimmed.fromFirstOccurrenceOf("-", false, false).getIntValue()
+			: from;
+
+		if (from < 1 || to < from || to > numChannels)
+		{
+			return false;
+		}
+
+		for (int channel = from; channel <= to; channel++)
+		{
+			channels.push_back(channel - 1);
+		}
+	}
+
+	return true;
+}
+
+void SpectrogramEditor::updateFftInfo()
+{
+	auto processor = (SpectrogramNode*)getProcessor();
+	int windowLength = processor->getWindowLengthSamples();
+	int fftLength = processor->getFftLength();
+	String lengthText;
+
+	if (processor->isWavelet())
+	{
+		lengthText = "CWT: " + String(fftLength) + " pts";
+	}
+	else if (processor->usesSlidingDft())
+	{
+		lengthText = "Sliding DFT: " + String(windowLength) + " pts";
+	}
+	else if (fftLength != windowLength)
+	{
+		lengthText = "FFT: " + String(windowLength) + " -> " + String(fftLength) + " pts";
+	}
+	else
+	{
+		lengthText = "FFT: " + String(fftLength) + " pts";
+	}
+
+	fftLengthInfoLabel->setText(lengthText, dontSendNotification);
+	fftCostInfoLabel->setText(
+		"Cost: ~" + String(processor->getEstimatedStepCostUs(), 1) + " us/step",
+		dontSendNotification);
 }
 
 Visualizer* SpectrogramEditor::createNewCanvas()
@@ -192,4 +729,6 @@ void SpectrogramEditor::updateSettings()
 	{
 		channelSelector->setSelectedId(2, sendNotification);
 	}
+
+	updateFftInfo();
 }
@@ -41,6 +41,11 @@ private:
     ScopedPointer<Label> maxFreqTextbox;
     ScopedPointer<Label> maxFreqUnitLabel;
 
+    String lastMinFreqString;
+    ScopedPointer<Label> minFreqLabel;
+    ScopedPointer<Label> minFreqTextbox;
+    ScopedPointer<Label> minFreqUnitLabel;
+
     String lastStepLengthString;
     ScopedPointer<Label> stepLengthLabel;
     ScopedPointer<Label> stepLengthTextbox;
@@ -51,6 +56,69 @@ private:
     ScopedPointer<Label> chartLengthTextbox;
     ScopedPointer<Label> chartLengthUnitLabel;
 
+    String lastChannelsString;
+    ScopedPointer<Label> channelsLabel;
+    ScopedPointer<Label> channelsTextbox;
+
+    String lastFftThreadsString;
+    ScopedPointer<Label> fftThreadsLabel;
+    ScopedPointer<Label> fftThreadsTextbox;
+
+    ScopedPointer<Label> overloadLabel;
+    ScopedPointer<ComboBox> overloadSelector;
+
+    ScopedPointer<ComboBox> keepHistorySelector;
+
+    String lastWindowLengthString;
+    ScopedPointer<Label> windowLengthLabel;
+    ScopedPointer<Label> windowLengthTextbox;
+    ScopedPointer<Label> windowLengthUnitLabel;
+
+    String lastNumTapersString;
+    ScopedPointer<Label> numTapersLabel;
+    ScopedPointer<Label> numTapersTextbox;
+
+    String lastTimeHalfBandwidthString;
+    ScopedPointer<Label> timeHalfBandwidthLabel;
+    ScopedPointer<Label> timeHalfBandwidthTextbox;
+
+    String lastWelchSegmentsString;
+    ScopedPointer<Label> welchSegmentsLabel;
+    ScopedPointer<Label> welchSegmentsTextbox;
+
+    String lastWaveletCyclesString;
+    ScopedPointer<Label> waveletCyclesLabel;
+    ScopedPointer<Label> waveletCyclesTextbox;
+
+    String lastScalesPerOctaveString;
+    ScopedPointer<Label> scalesPerOctaveLabel;
+    ScopedPointer<Label> scalesPerOctaveTextbox;
+
+    ScopedPointer<Label> frequencyAxisLabel;
+    ScopedPointer<ComboBox> frequencyAxisSelector;
+
+    ScopedPointer<Label> fftSizeLabel;
+    ScopedPointer<ComboBox> fftSizeSelector;
+    ScopedPointer<Label> fftLengthInfoLabel;
+    ScopedPointer<Label> fftCostInfoLabel;
+
+    ScopedPointer<Label> outputUnitLabel;
+    ScopedPointer<ComboBox> outputUnitSelector;
+
+    /** Validates the text of an edited textbox and passes it to the processor,
+        or restores the last valid text. */
+    void applyLabelText(Label* label);
+
+    /** Shows the effective FFT length and expected cost of the current settings. */
+    void updateFftInfo();
+
+    ScopedPointer<Label> windowFunctionLabel;
+    ScopedPointer<ComboBox> windowFunctionSelector;
+
+    /** Parses a 1-based channel list such as "1-32, 40" into 0-based channel
+        indices. Returns false if the text is malformed or out of range. */
+    bool parseChannelList(const String& text, std::vector<int>& channels) const;
+
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SpectrogramEditor);
 };
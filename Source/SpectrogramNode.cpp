@@ -1,6 +1,5 @@
-#include <cmath>
+#include <algorithm>
 
-#include "pocketfft_hdronly.h"
 #include "SpectrogramNode.h"
 
 using namespace SpectrogramViewer;
@@ -13,6 +12,7 @@ SpectrogramNode::SpectrogramNode() : GenericProcessor("Spectrogram")
 
 SpectrogramNode::~SpectrogramNode()
 {
+	stopWorkerAndWait();
 }
 
 AudioProcessorEditor* SpectrogramNode::createEditor()
@@ -23,63 +23,119 @@ AudioProcessorEditor* SpectrogramNode::createEditor()
 
 void SpectrogramNode::process(AudioSampleBuffer& buffer)
 {
-	if (selectedChannel < 0)
+	// Configuration changes take effect here, at a buffer boundary.
+	auto active = acquirePipeline(audioPipeline);
+
+	if (active)
 	{
-		return;
+		// All channels of a data stream arrive with the same number of samples,
+		// on the same sample clock.
+		int firstChannel = active->getChannels()[0];
+		int numInSamples = getNumSamples(firstChannel);
+		int64 firstSample = getTimestamp(firstChannel);
+		latestSampleNumber.store(firstSample + numInSamples, std::memory_order_relaxed);
+
+		// Never wait for the worker: whatever doesn't fit is dropped and counted.
+		int numQueued = active->write(buffer.getArrayOfReadPointers(), numInSamples, firstSample);
+
+		if (numQueued < numInSamples)
+		{
+			numDroppedSamples += numInSamples - numQueued;
+		}
 	}
 
-	int numInSamples = getNumSamples(selectedChannel);
-	int samplesPerStep = fftInBuffer.size();
-	auto channelData = buffer.getReadPointer(selectedChannel);
-	int numTotalSamples = numInSamples + leftoverSamples;
-	int numSteps = numTotalSamples / samplesPerStep;
+	audioPipeline.store(nullptr);
+}
+
+SpectrogramPipeline* SpectrogramNode::acquirePipeline(std::atomic<SpectrogramPipeline*>& hazard)
+{
+	// Announce the pipeline before using it, then check that it was still the
+	// published one at that point; a pipeline retired earlier is never picked up.
+	auto pipeline = activePipeline.load();
+
+	while (true)
+	{
+		hazard.store(pipeline);
+		auto published = activePipeline.load();
+
+		if (published == pipeline)
+		{
+			return pipeline;
+		}
 
-	int fromInSample = 0;
-	int toInSample = std::min(numInSamples, samplesPerStep - leftoverSamples);
+		pipeline = published;
+	}
+}
 
-	std::copy(&channelData[fromInSample], &channelData[toInSample], fftInBuffer.begin() + leftoverSamples);
+void SpectrogramNode::deleteRetiredPipelines()
+{
+	auto audioInUse = audioPipeline.load();
+	auto workerInUse = workerPipeline.load();
+
+	retiredPipelines.erase(
+		std::remove_if(retiredPipelines.begin(), retiredPipelines.end(),
+			[&](const std::unique_ptr<SpectrogramPipeline>& retired)
+			{
+				return retired.get() != audioInUse && retired.get() != workerInUse;
+			}),
+		retiredPipelines.end());
+}
 
-	if (numSteps == 0)
+void SpectrogramNode::startWorker()
+{
+	if (worker.joinable())
 	{
-		// Can't do any calculations.
-		leftoverSamples += numInSamples;
 		return;
 	}
 
-	// Clear the space in the output vector.
-	auto fromIndexToKeep = freqsPerSpectrogramColumn * numSteps;
-	std::copy(spectrogram.begin() + fromIndexToKeep, spectrogram.end(), spectrogram.begin());
+	stopWorker = false;
+	worker = std::thread([this] { runWorker(); });
+}
 
-	// Compute the spectrgram of the input data.
-	std::vector<float> fftOutBuffer(freqsPerSpectrogramColumn);
-	auto fromOutIndex = spectrogram.size() - freqsPerSpectrogramColumn * numSteps;
+void SpectrogramNode::stopWorkerAndWait()
+{
+	if (!worker.joinable())
+	{
+		return;
+	}
 
-	do
 	{
-		calcSpectrogram(fftInBuffer, fftOutBuffer, sqrtBandwidth);
+		std::lock_guard<std::mutex> lock(workerMutex);
+		stopWorker = true;
+	}
 
-		std::copy(
-			fftOutBuffer.begin(),
-			fftOutBuffer.begin() + freqsPerSpectrogramColumn,
-			spectrogram.begin() + fromOutIndex);
+	workAvailable.notify_one();
+	worker.join();
+}
 
-		fromOutIndex += freqsPerSpectrogramColumn;
+void SpectrogramNode::runWorker()
+{
+	while (!stopWorker)
+	{
+		// A pipeline that the audio thread has already left still has its last
+		// samples queued; they go with it, as the new one starts from scratch.
+		auto active = acquirePipeline(workerPipeline);
+
+		if (active)
+		{
+			int numQueued = active->getNumQueuedSamples();
 
-		// Prep the next input to calcSpectrogram().
-		fromInSample = toInSample;
-		toInSample += samplesPerStep;
-		toInSample = std::min(toInSample, numInSamples);
+			if (numQueued > maxQueuedSamples)
+			{
+				maxQueuedSamples = numQueued;
+			}
 
-		std::copy(&channelData[fromInSample], &channelData[toInSample], fftInBuffer.begin());
+			numDroppedSamples += active->processQueuedSamples(overloadPolicy == OVERLOAD_DROP);
+		}
 
-	} while (toInSample - fromInSample == samplesPerStep);
+		workerPipeline.store(nullptr);
 
-	// If all samples were processed, then after the last iteration of the 
-	// loop above, we should have ended up with toInSample == fromInSample.
-	// Otherwise, we'll have some leftover samples that should be combined with the
-	// next batch of samples.
-	leftoverSamples = toInSample - fromInSample;
-	lastDataUpdateTime = Time::currentTimeMillis();
+		// Poll rather than have process() wake us, which would cost the audio
+		// thread a system call on every buffer. A buffer waits at most one
+		// period, well under a step.
+		std::unique_lock<std::mutex> lock(workerMutex);
+		workAvailable.wait_for(lock, std::chrono::milliseconds(10), [this] { return stopWorker.load(); });
+	}
 }
 
 void SpectrogramNode::setParameter(int paramIndex, float newValue)
@@ -88,21 +144,74 @@ void SpectrogramNode::setParameter(int paramIndex, float newValue)
 	{
 	case PARAM_CHANNEL:
 		selectedChannel = int(newValue);
-		break;
+		resizeBuffers(false);
+		return;
 	case PARAM_MAX_SHOWN_FREQ:
-		maxShownFrequency = newValue;
+		settings.maxShownFrequency = newValue;
+		break;
+	case PARAM_MIN_SHOWN_FREQ:
+		settings.minShownFrequency = newValue;
+		break;
+	case PARAM_NUM_TAPERS:
+		settings.numTapers = std::max(1, int(newValue));
+		break;
+	case PARAM_TIME_HALF_BANDWIDTH:
+		settings.timeHalfBandwidth = newValue;
+		break;
+	case PARAM_WELCH_SEGMENTS:
+		settings.numWelchSegments = std::max(1, int(newValue));
+		break;
+	case PARAM_WAVELET_CYCLES:
+		settings.waveletCycles = std::max(0.f, newValue);
+		break;
+	case PARAM_SCALES_PER_OCTAVE:
+		settings.scalesPerOctave = std::max(1, int(newValue));
+		break;
+	case PARAM_LOG_FREQUENCY_AXIS:
+		settings.logFrequencyAxis = newValue != 0;
+		break;
+	case PARAM_PAD_FFT:
+		settings.padFftToFastLength = newValue != 0;
+		break;
+	case PARAM_DECIBEL_OUTPUT:
+		settings.decibelOutput = newValue != 0;
+		break;
+	case PARAM_HISTORY_FORMAT:
+		settings.historyFormat = HistoryFormat(std::max(0, std::min(int(newValue), int(HISTORY_LEVELS_16))));
 		break;
 	case PARAM_STEP_LENGTH_SEC:
-		stepLengthSec = newValue;
+		settings.stepLengthSec = newValue;
 		break;
 	case PARAM_CHART_LENGTH_SEC:
-		chartLengthSec = newValue;
+		settings.chartLengthSec = newValue;
+		break;
+	case PARAM_NUM_FFT_THREADS:
+		settings.numFftThreads = std::max(1, int(newValue));
+		break;
+	case PARAM_OVERLOAD_POLICY:
+		overloadPolicy = int(newValue);
+		return;
+	case PARAM_KEEP_HISTORY:
+		keepHistory = newValue != 0;
+		return;
+	case PARAM_WINDOW_LENGTH_SEC:
+		settings.windowLengthSec = newValue;
+		break;
+	case PARAM_WINDOW_FUNCTION:
+		settings.windowFunction = int(newValue);
 		break;
 	}
 
 	resizeBuffers();
 }
 
+void SpectrogramNode::setOutputFormat(bool decibelOutput, HistoryFormat historyFormat)
+{
+	settings.decibelOutput = decibelOutput;
+	settings.historyFormat = HistoryFormat(std::max(0, std::min(int(historyFormat), int(HISTORY_LEVELS_16))));
+	resizeBuffers();
+}
+
 float SpectrogramNode::getParameter(int parameterIndex)
 {
 	switch (parameterIndex)
@@ -110,11 +219,41 @@ float SpectrogramNode::getParameter(int parameterIndex)
 	case PARAM_CHANNEL:
 		return selectedChannel;
 	case PARAM_MAX_SHOWN_FREQ:
-		return maxShownFrequency;
+		return settings.maxShownFrequency;
+	case PARAM_MIN_SHOWN_FREQ:
+		return settings.minShownFrequency;
+	case PARAM_NUM_TAPERS:
+		return settings.numTapers;
+	case PARAM_TIME_HALF_BANDWIDTH:
+		return settings.timeHalfBandwidth;
+	case PARAM_WELCH_SEGMENTS:
+		return settings.numWelchSegments;
+	case PARAM_WAVELET_CYCLES:
+		return settings.waveletCycles;
+	case PARAM_SCALES_PER_OCTAVE:
+		return settings.scalesPerOctave;
+	case PARAM_LOG_FREQUENCY_AXIS:
+		return settings.logFrequencyAxis;
+	case PARAM_PAD_FFT:
+		return settings.padFftToFastLength;
+	case PARAM_DECIBEL_OUTPUT:
+		return settings.decibelOutput;
+	case PARAM_HISTORY_FORMAT:
+		return settings.historyFormat;
 	case PARAM_STEP_LENGTH_SEC:
-		return stepLengthSec;
+		return settings.stepLengthSec;
 	case PARAM_CHART_LENGTH_SEC:
-		return chartLengthSec;
+		return settings.chartLengthSec;
+	case PARAM_NUM_FFT_THREADS:
+		return settings.numFftThreads;
+	case PARAM_OVERLOAD_POLICY:
+		return overloadPolicy;
+	case PARAM_WINDOW_LENGTH_SEC:
+		return settings.windowLengthSec;
+	case PARAM_WINDOW_FUNCTION:
+		return settings.windowFunction;
+	case PARAM_KEEP_HISTORY:
+		return keepHistory;
 	}
 
 	return 0;
@@ -128,10 +267,40 @@ const String SpectrogramNode::getParameterName(int parameterIndex)
 		return "PARAM_CHANNEL";
 	case PARAM_MAX_SHOWN_FREQ:
 		return "PARAM_MAX_SHOWN_FREQ";
+	case PARAM_MIN_SHOWN_FREQ:
+		return "PARAM_MIN_SHOWN_FREQ";
+	case PARAM_NUM_TAPERS:
+		return "PARAM_NUM_TAPERS";
+	case PARAM_TIME_HALF_BANDWIDTH:
+		return "PARAM_TIME_HALF_BANDWIDTH";
+	case PARAM_WELCH_SEGMENTS:
+		return "PARAM_WELCH_SEGMENTS";
+	case PARAM_WAVELET_CYCLES:
+		return "PARAM_WAVELET_CYCLES";
+	case PARAM_SCALES_PER_OCTAVE:
+		return "PARAM_SCALES_PER_OCTAVE";
+	case PARAM_LOG_FREQUENCY_AXIS:
+		return "PARAM_LOG_FREQUENCY_AXIS";
+	case PARAM_PAD_FFT:
+		return "PARAM_PAD_FFT";
+	case PARAM_DECIBEL_OUTPUT:
+		return "PARAM_DECIBEL_OUTPUT";
+	case PARAM_HISTORY_FORMAT:
+		return "PARAM_HISTORY_FORMAT";
 	case PARAM_STEP_LENGTH_SEC:
 		return "PARAM_STEP_LENGTH_SEC";
 	case PARAM_CHART_LENGTH_SEC:
 		return "PARAM_CHART_LENGTH_SEC";
+	case PARAM_NUM_FFT_THREADS:
+		return "PARAM_NUM_FFT_THREADS";
+	case PARAM_OVERLOAD_POLICY:
+		return "PARAM_OVERLOAD_POLICY";
+	case PARAM_WINDOW_LENGTH_SEC:
+		return "PARAM_WINDOW_LENGTH_SEC";
+	case PARAM_WINDOW_FUNCTION:
+		return "PARAM_WINDOW_FUNCTION";
+	case PARAM_KEEP_HISTORY:
+		return "PARAM_KEEP_HISTORY";
 	}
 
 	return "";
@@ -139,6 +308,10 @@ const String SpectrogramNode::getParameterName(int parameterIndex)
 
 bool SpectrogramNode::enable()
 {
+	numDroppedSamples = 0;
+	maxQueuedSamples = 0;
+	startWorker();
+
 	auto editor = (SpectrogramEditor*)getEditor();
 	editor->enable();
 	return true;
@@ -146,51 +319,98 @@ bool SpectrogramNode::enable()
 
 bool SpectrogramNode::disable()
 {
+	stopWorkerAndWait();
+	deleteRetiredPipelines();
+
 	auto editor = (SpectrogramEditor*)getEditor();
 	editor->disable();
 	return true;
 }
 
-void SpectrogramNode::resizeBuffers()
+void SpectrogramNode::setRequestedChannels(const std::vector<int>& channels)
 {
-	if (selectedChannel < 0)
+	requestedChannels = channels;
+	resizeBuffers();
+}
+
+const SpectrogramHistory& SpectrogramNode::getSpectrogram(int channel) const
+{
+	auto it = std::lower_bound(spectrogramChannels.begin(), spectrogramChannels.end(), channel);
+
+	if (!pipeline || it == spectrogramChannels.end() || *it != channel)
 	{
-		return;
+		return noSpectrogram;
 	}
 
-	auto sampleRate = getDataChannel(selectedChannel)->getSampleRate();
-	int samplesPerStep = std::round(sampleRate * stepLengthSec);
-	fftInBuffer.assign(samplesPerStep, 0);
-	
-	freqsPerSpectrogramColumn = std::floor(maxShownFrequency * stepLengthSec) + 1;
-	sqrtBandwidth = std::sqrt(1 / stepLengthSec);
+	return pipeline->getSpectrogram(it - spectrogramChannels.begin());
+}
 
-	int numStepsToShow = std::round(chartLengthSec / stepLengthSec);
-	spectrogram.assign(numStepsToShow * freqsPerSpectrogramColumn, NAN);
+const SpectrogramHistory& SpectrogramNode::getWelchAverages(int channel) const
+{
+	auto it = std::lower_bound(spectrogramChannels.begin(), spectrogramChannels.end(), channel);
+
+	if (!pipeline || it == spectrogramChannels.end() || *it != channel)
+	{
+		return noSpectrogram;
+	}
 
-	leftoverSamples = 0;
+	return pipeline->getWelchAverages(it - spectrogramChannels.begin());
 }
 
-void SpectrogramNode::calcSpectrogram(
-	const std::vector<float>& inBuf,
-	std::vector<float>& outBuf,
-	float sqrtBandwidth) const
+void SpectrogramNode::resizeBuffers(bool settingsChanged)
 {
-	pocketfft::detail::shape_t shape_in { inBuf.size() };
-	pocketfft::detail::stride_t stride_in { sizeof(float) };
-	pocketfft::detail::stride_t stride_out { sizeof(float) };
+	std::vector<int> channels;
 
-	std::vector<std::complex<float>> fftResult(inBuf.size() / 2 + 1);
-	bool forward = true;
+	for (auto channel : requestedChannels)
+	{
+		if (channel >= 0 && channel < getTotalDataChannels())
+		{
+			channels.push_back(channel);
+		}
+	}
+
+	if (selectedChannel >= 0 && selectedChannel < getTotalDataChannels())
+	{
+		channels.push_back(selectedChannel);
+	}
 
-	// All incoming data is in microvolts, so we'll need to adjust the scaling factor accordingly.
-	auto scalingFactor = 1 / sqrtBandwidth / 1000000;
+	std::sort(channels.begin(), channels.end());
+	channels.erase(std::unique(channels.begin(), channels.end()), channels.end());
 
-	pocketfft::detail::r2c(
-		shape_in, stride_in, stride_out, 0, forward, inBuf.data(), fftResult.data(), scalingFactor);
+	// Switching to a channel that is already computed keeps everything as is,
+	// unless a new source kept the channel indices but not the sample rate.
+	bool sameChannels = channels == spectrogramChannels;
 
-	for (int i = 0; i < outBuf.size(); i++)
+	if (sameChannels && pipeline && !channels.empty())
 	{
-		outBuf[i] = std::abs(fftResult[i]);
+		sameChannels = pipeline->getInputSampleRate() == getDataChannel(channels[0])->getSampleRate();
 	}
-}
\ No newline at end of file
+
+	if (!settingsChanged && sameChannels && (pipeline || channels.empty()))
+	{
+		return;
+	}
+
+	std::unique_ptr<SpectrogramPipeline> next;
+
+	if (!channels.empty())
+	{
+		// The channels are assumed to share the sample rate of the first one.
+		auto sampleRate = getDataChannel(channels[0])->getSampleRate();
+		next.reset(new SpectrogramPipeline(settings, channels, sampleRate, pipeline.get(), keepHistory));
+	}
+
+	// From here on the audio thread and the worker move over at their next
+	// buffer; the old pipeline stays alive until both have let go of it.
+	activePipeline.store(next.get());
+	spectrogramChannels = channels;
+
+	if (pipeline)
+	{
+		retiredPipelines.push_back(std::move(pipeline));
+	}
+
+	pipeline = std::move(next);
+	configurationNumber++;
+	deleteRetiredPipelines();
+}
@@ -1,10 +1,16 @@
 //This prevents include loops. We recommend changing the macro to a name suitable for your plugin
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 #include <ProcessorHeaders.h>
 #include "SpectrogramEditor.h"
+#include "SpectrogramPipeline.h"
 
 //namespace must be an unique name for your plugin
 namespace SpectrogramViewer
@@ -16,6 +22,27 @@ namespace SpectrogramViewer
 		static const int PARAM_MAX_SHOWN_FREQ = 1;
 		static const int PARAM_STEP_LENGTH_SEC = 2;
 		static const int PARAM_CHART_LENGTH_SEC = 3;
+		static const int PARAM_NUM_FFT_THREADS = 4;
+		static const int PARAM_OVERLOAD_POLICY = 5;
+		static const int PARAM_WINDOW_LENGTH_SEC = 6;
+		static const int PARAM_WINDOW_FUNCTION = 7;
+		static const int PARAM_MIN_SHOWN_FREQ = 8;
+		static const int PARAM_NUM_TAPERS = 9;
+		static const int PARAM_TIME_HALF_BANDWIDTH = 10;
+		static const int PARAM_WELCH_SEGMENTS = 11;
+		static const int PARAM_WAVELET_CYCLES = 12;
+		static const int PARAM_SCALES_PER_OCTAVE = 13;
+		static const int PARAM_LOG_FREQUENCY_AXIS = 14;
+		static const int PARAM_PAD_FFT = 15;
+		static const int PARAM_DECIBEL_OUTPUT = 16;
+		static const int PARAM_HISTORY_FORMAT = 17;
+		static const int PARAM_KEEP_HISTORY = 18;
+
+		/** Overload policies: when the worker falls behind, either keep every sample
+		and let the display lag (up to the input FIFO size), or drop the backlog
+		so the display stays close to real time. */
+		static const int OVERLOAD_LAG = 0;
+		static const int OVERLOAD_DROP = 1;
 
 		/** The class constructor, used to initialize any members. */
 		SpectrogramNode();
@@ -36,7 +63,7 @@ namespace SpectrogramViewer
 		virtual bool disable() override;
 
 		/** Returns true if a processor is ready to process data (e.g., all of its parameters are initialized, and its data source is connected).*/
-		virtual bool isReady() override { return selectedChannel >= 0; }
+		virtual bool isReady() override { return !spectrogramChannels.empty(); }
 
 		/** Defines the functionality of the processor.
 
@@ -47,6 +74,9 @@ namespace SpectrogramViewer
 
 		Continuous signals arrive in the "buffer" variable, event data (such as TTLs
 		and spikes) is contained in the "events" variable.
+
+		Here it only queues the samples of the spectrogram channels; the worker
+		thread computes the spectrogram columns.
 		*/
 		void process(AudioSampleBuffer& buffer) override;
 
@@ -72,7 +102,7 @@ namespace SpectrogramViewer
 		float getParameter(int parameterIndex) override;
 
 		/** Returns the number of user-editable parameters for this processor.*/
-		int getNumParameters() override { return 4; }
+		int getNumParameters() override { return 19; }
 
 		/** Returns the name of the parameter with a given index.*/
 		const String getParameterName(int parameterIndex) override;
@@ -93,36 +123,195 @@ namespace SpectrogramViewer
 		*/
 		//void updateSettings() override;
 
-		float getMaxShownFrequency() const { return maxShownFrequency; }
-		float getStepLengthSec() const { return stepLengthSec; }
-		float getChartLengthSec() const { return chartLengthSec; }
-
-		const std::vector<float>& getSpectrogram() const { return spectrogram; }
-		int getNumFreqsPerSpectrigramColumn() const { return freqsPerSpectrogramColumn; }
-		int getNumSpectrogramColumns() const { return chartLengthSec / stepLengthSec; }
-		int64 getLastDataUpdateTime() const { return lastDataUpdateTime; }
+		float getMaxShownFrequency() const { return settings.maxShownFrequency; }
+		float getMinShownFrequency() const { return settings.minShownFrequency; }
+
+		/** Band (zoom FFT) mode is on whenever the lower bound of the shown
+		frequencies is above 0 Hz. */
+		bool isBandMode() const { return settings.isBandMode(); }
+
+		float getWaveletCycles() const { return settings.waveletCycles; }
+		int getScalesPerOctave() const { return settings.scalesPerOctave; }
+		bool getLogFrequencyAxis() const { return settings.logFrequencyAxis; }
+		bool getPadFftToFastLength() const { return settings.padFftToFastLength; }
+
+		/** Returns true if the histories hold 20 log10 of the magnitudes, i.e.
+		dB re 1 V/sqrt(Hz), rather than the magnitudes themselves. The log is
+		then taken once per column as it is produced, and the display only
+		rescales it. The Welch averages are linear either way. */
+		bool isDecibelOutput() const { return settings.decibelOutput; }
+
+		/** Returns how the histories store the columns (PARAM_HISTORY_FORMAT).
+		The quantized formats span the colour scale's range, so their levels
+		map straight onto the palette; isDecibelOutput() only applies to
+		HISTORY_FLOAT. */
+		HistoryFormat getHistoryFormat() const { return settings.historyFormat; }
+
+		/** Sets PARAM_DECIBEL_OUTPUT and PARAM_HISTORY_FORMAT together, so that
+		switching the output unit rebuilds the pipeline once rather than twice. */
+		void setOutputFormat(bool decibelOutput, HistoryFormat historyFormat);
+
+		/** Returns true if a configuration change resamples the histories onto
+		the new rows and step (PARAM_KEEP_HISTORY) rather than clearing them. */
+		bool getKeepHistory() const { return keepHistory; }
+
+		/** Returns the number of samples in each window, after decimation. */
+		int getWindowLengthSamples() const { return pipeline ? pipeline->getWindowLengthSamples() : 0; }
+
+		/** Returns the length of the transforms: the window length, or the fast
+		length it is zero-padded to (PARAM_PAD_FFT). In wavelet mode, the length
+		of the convolution blocks. */
+		int getFftLength() const { return pipeline ? pipeline->getFftLength() : 0; }
+
+		/** Returns the expected worker time per step for all channels, in
+		microseconds, from the cost models of the transforms. */
+		double getEstimatedStepCostUs() const { return pipeline ? pipeline->getEstimatedStepCostUs() : 0; }
+
+		/** Returns true if the pipeline updates a sliding DFT sample by sample
+		instead of transforming every window, which it does for short steps
+		when the cost models say that is cheaper. */
+		bool usesSlidingDft() const { return pipeline && pipeline->usesSlidingDft(); }
+
+		/** Wavelet mode is on when the number of Morlet cycles is above 0. Its rows
+		are log-spaced scales from getLowestShownFrequency() to the max frequency,
+		getScalesPerOctave() per octave; it ignores the window settings. */
+		bool isWavelet() const { return settings.isWavelet(); }
+
+		/** Returns the frequency of the bottom row of the spectrogram. */
+		float getLowestShownFrequency() const { return settings.getLowestShownFrequency(); }
+
+		/** Returns true if the rows are log-spaced in frequency rather than
+		linearly, getScalesPerOctave() rows per octave. Wavelet mode always is;
+		the FFT modes are when PARAM_LOG_FREQUENCY_AXIS is set, and then map
+		their bins onto the rows in the node, so every history row is one
+		display row. */
+		bool isLogFrequencyAxis() const { return settings.isLogFrequencyAxis(); }
+
+		int getNumTapers() const { return settings.numTapers; }
+		float getTimeHalfBandwidth() const { return settings.timeHalfBandwidth; }
+
+		/** Multitaper mode is on when more than one taper is requested. It replaces
+		the window function with that many DPSS tapers of the given NW, and shows
+		the average of their power spectra. Band mode ignores it. */
+		bool isMultitaper() const { return settings.isMultitaper(); }
+
+		float getStepLengthSec() const { return settings.stepLengthSec; }
+		float getWindowLengthSec() const { return settings.windowLengthSec; }
+		int getWindowFunction() const { return settings.windowFunction; }
+		float getChartLengthSec() const { return settings.chartLengthSec; }
+		int getNumFftThreads() const { return settings.numFftThreads; }
+		int getOverloadPolicy() const { return overloadPolicy; }
+
+		/** Returns the number of input samples per channel that were discarded
+		because the worker thread could not keep up. */
+		int64 getNumDroppedSamples() const { return numDroppedSamples; }
+
+		/** Returns how many samples per channel are waiting for the worker thread. */
+		int getNumQueuedSamples() const { return pipeline ? pipeline->getNumQueuedSamples() : 0; }
+
+		/** Returns the largest backlog seen since acquisition started. */
+		int getMaxQueuedSamples() const { return maxQueuedSamples; }
+
+		/** Returns the sample number just past the last buffer that process()
+		received, on the same clock as ColumnInfo::firstSample. */
+		int64 getLatestSampleNumber() const { return latestSampleNumber.load(std::memory_order_relaxed); }
+
+		/** Returns the sample rate of the spectrogram channels, or 0 if there are none. */
+		double getSampleRate() const { return pipeline ? pipeline->getInputSampleRate() : 0; }
+
+		/** Sets the channels to compute spectrograms for, in addition to the
+		displayed channel (PARAM_CHANNEL). */
+		void setRequestedChannels(const std::vector<int>& channels);
+		const std::vector<int>& getRequestedChannels() const { return requestedChannels; }
+
+		/** Returns all channels that spectrograms are computed for, in ascending order. */
+		const std::vector<int>& getSpectrogramChannels() const { return spectrogramChannels; }
+
+		/** Returns the history of the displayed channel, written by the worker thread.
+		Other threads must only read it through SpectrogramHistory::copyNewColumnsFrom().
+
+		The histories of all channels are replaced whenever the configuration
+		changes, so only hold on to them on the message thread, until the next
+		parameter change. Each column's ColumnInfo tells which input samples it
+		covers, by the processor's timestamps. */
+		const SpectrogramHistory& getSpectrogram() const { return getSpectrogram(selectedChannel); }
+
+		/** Returns the history of the given channel, or an empty one if the channel
+		is not in getSpectrogramChannels(). */
+		const SpectrogramHistory& getSpectrogram(int channel) const;
+
+		int getNumWelchSegments() const { return settings.numWelchSegments; }
+
+		/** Returns the Welch-averaged power spectral density of the given channel
+		in V^2/Hz: the mean square of the densities in its last
+		getNumWelchSegments() spectrogram columns. Each update is published as a
+		new column; read it like getSpectrogram(). The canvas draws the one of
+		the displayed channel. */
+		const SpectrogramHistory& getWelchAverages(int channel) const;
+		const SpectrogramHistory& getWelchAverages() const { return getWelchAverages(selectedChannel); }
+
+		/** Returns a number that changes whenever the histories are replaced
+		by a configuration change. */
+		int getConfigurationNumber() const { return configurationNumber; }
+
+		/** Deletes the retired pipelines that no thread is using any more. Call
+		on the message thread; the canvas does so on every refresh, so that a
+		replaced pipeline doesn't outlive the buffer it was last used in by much. */
+		void deleteRetiredPipelines();
+
+		int getNumFreqsPerSpectrigramColumn() const { return pipeline ? pipeline->getNumRows() : 0; }
+		int getNumSpectrogramColumns() const { return getSpectrogram().getNumColumns(); }
 
 	private:
-		int selectedChannel;
-		float maxShownFrequency = 300;
-		float stepLengthSec = 0.1;
-		float chartLengthSec = 5;
-
-		std::vector<float> fftInBuffer;
-		int leftoverSamples = 0;
-
-		std::vector<float> spectrogram;
-		int freqsPerSpectrogramColumn;
-		float sqrtBandwidth;
-
-		int64 lastDataUpdateTime = 0;
-
-		void resizeBuffers();
-
-		void calcSpectrogram(
-			const std::vector<float>& inBuf,
-			std::vector<float>& outBuf,
-			float sqrtBandwidth) const;
+		int selectedChannel = -1;
+		SpectrogramSettings settings;
+		bool keepHistory = true;
+		std::atomic<int> overloadPolicy { OVERLOAD_LAG };
+
+		std::vector<int> requestedChannels;
+		std::vector<int> spectrogramChannels;
+
+		// The pipeline of the current configuration, owned by the message
+		// thread. Configuration changes never touch it: they build a new one
+		// and publish it through activePipeline, which the audio and worker
+		// threads pick up at their next buffer or pass (read-copy-update).
+		std::unique_ptr<SpectrogramPipeline> pipeline;
+		std::atomic<SpectrogramPipeline*> activePipeline { nullptr };
+
+		// Hazard pointers: the pipeline that the audio thread and the worker
+		// are using, or null between buffers and passes. A replaced pipeline
+		// is retired, and deleted on the message thread once neither holds it.
+		std::atomic<SpectrogramPipeline*> audioPipeline { nullptr };
+		std::atomic<SpectrogramPipeline*> workerPipeline { nullptr };
+		std::vector<std::unique_ptr<SpectrogramPipeline>> retiredPipelines;
+		int configurationNumber = 0;
+
+		// The worker polls for samples; it is only woken early to stop.
+		std::thread worker;
+		std::mutex workerMutex;
+		std::condition_variable workAvailable;
+		std::atomic<bool> stopWorker { false };
+
+		std::atomic<int64> numDroppedSamples { 0 };
+		std::atomic<int> maxQueuedSamples { 0 };
+		std::atomic<int64> latestSampleNumber { 0 };
+
+		SpectrogramHistory noSpectrogram;
+
+		/** Builds a pipeline for the current settings and channels, off the
+		audio thread, and publishes it in place of the current one. Unless
+		settingsChanged, only does so if the set of channels changed. */
+		void resizeBuffers(bool settingsChanged = true);
+
+		/** Returns the published pipeline after announcing it in hazard; the
+		caller clears hazard once done with it. Never blocks. */
+		SpectrogramPipeline* acquirePipeline(std::atomic<SpectrogramPipeline*>& hazard);
+
+		void startWorker();
+		void stopWorkerAndWait();
+
+		/** Worker thread loop: waits for queued samples and processes them. */
+		void runWorker();
 
 		JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SpectrogramNode);
 	};